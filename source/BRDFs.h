@@ -16,11 +16,6 @@ namespace dae
 			return ((cd * kd) * INV_PI);
 		}
 
-		static ColorRGB Lambert(const ColorRGB& kd, const ColorRGB& cd)
-		{
-			return ((cd * kd) * INV_PI);
-		}
-
 		/**
 		 * \brief todo
 		 * \param ks Specular Reflection Coefficient
@@ -53,17 +48,36 @@ namespace dae
 			return (f0 + (ColorRGB{1.f, 1.f, 1.f} - f0) * powf((1 - (std::max(Vector3::Dot(h, v), 0.0f))), 5));
 		}
 
+		/**
+		 * \brief Roughness remapping shared by the GGX terms (UE4 implemetation - squared(roughness)), only depends on the material so it gets baked
+		 * \param roughness Roughness of the material
+		 * \return alpha squared, as used by NormalDistribution_GGX
+		 */
+		static float RoughnessToAlphaSquared(float roughness)
+		{
+			const float alpha{ roughness * roughness };
+			return alpha * alpha;
+		}
+
+		/**
+		 * \param roughness Roughness of the material
+		 * \return k for direct lighting, as used by GeometryFunction_SchlickGGX (kIndirect would be { (Square(alpha)/2)})
+		 */
+		static float RoughnessToKDirect(float roughness)
+		{
+			const float alpha{ roughness * roughness };
+			return Square(alpha + 1.f) / 8.f;
+		}
+
 		/**
 		 * \brief BRDF NormalDistribution >> Trowbridge-Reitz GGX (UE4 implemetation - squared(roughness)) >> D
 		 * \param n Surface normal
 		 * \param h Normalized half vector
-		 * \param roughness Roughness of the material
+		 * \param alphaSqrd Squared alpha of the material (see RoughnessToAlphaSquared)
 		 * \return BRDF Normal Distribution Term using Trowbridge-Reitz GGX
 		 */
-		static float NormalDistribution_GGX(const Vector3& n, const Vector3& h, float roughness)
+		static float NormalDistribution_GGX(const Vector3& n, const Vector3& h, float alphaSqrd)
 		{
-			const float alpha{ roughness * roughness };
-			const float alphaSqrd{ alpha * alpha };
 			const float dot{ std::max(Vector3::Dot(n,h), 0.0f) };
 			const float dotSqrd{ dot * dot };
 
@@ -75,13 +89,11 @@ namespace dae
 		 * \brief BRDF Geometry Function >> Schlick GGX (Direct Lighting + UE4 implementation - squared(roughness)) >> G
 		 * \param n Normal of the surface
 		 * \param v Normalized view direction
-		 * \param roughness Roughness of the material
+		 * \param kDirect Remapped roughness of the material (see RoughnessToKDirect)
 		 * \return BRDF Geometry Term using SchlickGGX
 		 */
-		static float GeometryFunction_SchlickGGX(const Vector3& n, const Vector3& v, float roughness)
+		static float GeometryFunction_SchlickGGX(const Vector3& n, const Vector3& v, float kDirect)
 		{
-			const float alpha{ roughness * roughness };
-			const float kDirect{ (Square(alpha + 1.f) / 8.f) }; // kIndirect would be { (Square(alpha)/2)}
 			const float dotResult{ std::max(Vector3::Dot(n,v), 0.0f) }; // result of dot, not negative
 
 			return (dotResult / ((dotResult * (1.f - kDirect) + kDirect)) );
@@ -92,12 +104,12 @@ namespace dae
 		 * \param n Normal of the surface
 		 * \param v Normalized view direction
 		 * \param l Normalized light direction
-		 * \param roughness Roughness of the material
-		 * \return BRDF Geometry Term using Smith (> SchlickGGX(n,v,roughness) * SchlickGGX(n,l,roughness))
+		 * \param kDirect Remapped roughness of the material (see RoughnessToKDirect)
+		 * \return BRDF Geometry Term using Smith (> SchlickGGX(n,v,kDirect) * SchlickGGX(n,l,kDirect))
 		 */
-		static float GeometryFunction_Smith(const Vector3& n, const Vector3& v, const Vector3& l, float roughness)
+		static float GeometryFunction_Smith(const Vector3& n, const Vector3& v, const Vector3& l, float kDirect)
 		{
-			return (GeometryFunction_SchlickGGX(n, v, roughness) * GeometryFunction_SchlickGGX(n, l, roughness));
+			return (GeometryFunction_SchlickGGX(n, v, kDirect) * GeometryFunction_SchlickGGX(n, l, kDirect));
 		}
 
 	}
@@ -0,0 +1,59 @@
+#include "BVHValidation.h"
+
+#include <vector>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	bool BVHValidation::IsLeafRangeValid(uint64_t firstTriIdx, uint64_t triCount, uint64_t indexCount)
+	{
+		return firstTriIdx % 3 == 0 && triCount % 3 == 0 && firstTriIdx + triCount <= indexCount;
+	}
+
+	bool BVHValidation::AreNodesValid(const BVHNode* pNodes, uint64_t nodeCount, uint64_t indexCount)
+	{
+		std::vector<unsigned int> depths(nodeCount, 0);
+		for (uint64_t nodeIdx{ 0 }; nodeIdx < nodeCount; ++nodeIdx)
+		{
+			const BVHNode& node{ pNodes[nodeIdx] };
+			if (node.IsLeaf())
+			{
+				if (!IsLeafRangeValid(node.firstTriIdx, node.triCount, indexCount))
+					return false;
+				continue;
+			}
+
+			if (node.leftNode <= nodeIdx || node.leftNode + uint64_t{ 1 } >= nodeCount || depths[nodeIdx] >= BVHMaxDepth)
+				return false;
+			depths[node.leftNode] = depths[node.leftNode + 1] = depths[nodeIdx] + 1;
+		}
+		return true;
+	}
+
+	bool BVHValidation::AreWideNodesValid(const WideBVHNode* pNodes, uint64_t nodeCount, uint64_t indexCount)
+	{
+		std::vector<unsigned int> depths(nodeCount, 0);
+		for (uint64_t nodeIdx{ 0 }; nodeIdx < nodeCount; ++nodeIdx)
+		{
+			const WideBVHNode& node{ pNodes[nodeIdx] };
+			if (node.childCount < 1 || node.childCount > WideBVHWidth)
+				return false;
+
+			for (int i{ 0 }; i < node.childCount; ++i)
+			{
+				if (node.triCount[i] != 0)
+				{
+					if (!IsLeafRangeValid(node.child[i], node.triCount[i], indexCount))
+						return false;
+					continue;
+				}
+
+				if (node.child[i] <= nodeIdx || node.child[i] >= nodeCount || depths[nodeIdx] >= BVHMaxDepth)
+					return false;
+				depths[node.child[i]] = depths[nodeIdx] + 1;
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+
+namespace dae
+{
+	struct BVHNode;
+	struct WideBVHNode;
+
+	/**
+	 * \brief Checks for BVHs that come from a file (MeshFile, MeshCache) instead of the builders.
+	 * The traversal trusts the node links, so a broken file could send it outside the nodes or triangles, into a loop or past the end of its stack.
+	 * Children always get a higher index than their parent and the depth stays within BVHMaxDepth, anything else isn't a tree the builders made.
+	 */
+	namespace BVHValidation
+	{
+		// a leaf range of triCount indices starting at firstTriIdx, whole triangles inside the index buffer
+		bool IsLeafRangeValid(uint64_t firstTriIdx, uint64_t triCount, uint64_t indexCount);
+
+		bool AreNodesValid(const BVHNode* pNodes, uint64_t nodeCount, uint64_t indexCount);
+
+		// leaves point into the leaf triangles, which are in the same order as the indices
+		bool AreWideNodesValid(const WideBVHNode* pNodes, uint64_t nodeCount, uint64_t indexCount);
+	}
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+
 #include "MathHelpers.h"
 
 namespace dae
@@ -9,20 +11,20 @@ namespace dae
 		float g{};
 		float b{};
 
-		void MaxToOne()
+		constexpr void MaxToOne()
 		{
 			const float maxValue = std::max(r, std::max(g, b));
 			if (maxValue > 1.f)
 				*this /= maxValue;
 		}
 
-		static ColorRGB Lerp(const ColorRGB& c1, const ColorRGB& c2, float factor)
+		static constexpr ColorRGB Lerp(const ColorRGB& c1, const ColorRGB& c2, float factor)
 		{
 			return { Lerpf(c1.r, c2.r, factor), Lerpf(c1.g, c2.g, factor), Lerpf(c1.b, c2.b, factor) };
 		}
 
 		#pragma region ColorRGB (Member) Operators
-		const ColorRGB& operator+=(const ColorRGB& c)
+		constexpr const ColorRGB& operator+=(const ColorRGB& c)
 		{
 			r += c.r;
 			g += c.g;
@@ -31,17 +33,17 @@ namespace dae
 			return *this;
 		}
 
-		const ColorRGB& operator+(const ColorRGB& c)
+		constexpr const ColorRGB& operator+(const ColorRGB& c)
 		{
 			return *this += c;
 		}
 
-		ColorRGB operator+(const ColorRGB& c) const
+		constexpr ColorRGB operator+(const ColorRGB& c) const
 		{
 			return { r + c.r, g + c.g, b + c.b };
 		}
 
-		const ColorRGB& operator-=(const ColorRGB& c)
+		constexpr const ColorRGB& operator-=(const ColorRGB& c)
 		{
 			r -= c.r;
 			g -= c.g;
@@ -50,17 +52,17 @@ namespace dae
 			return *this;
 		}
 
-		const ColorRGB& operator-(const ColorRGB& c)
+		constexpr const ColorRGB& operator-(const ColorRGB& c)
 		{
 			return *this -= c;
 		}
 
-		ColorRGB operator-(const ColorRGB& c) const
+		constexpr ColorRGB operator-(const ColorRGB& c) const
 		{
 			return { r - c.r, g - c.g, b - c.b };
 		}
 
-		const ColorRGB& operator*=(const ColorRGB& c)
+		constexpr const ColorRGB& operator*=(const ColorRGB& c)
 		{
 			r *= c.r;
 			g *= c.g;
@@ -69,17 +71,17 @@ namespace dae
 			return *this;
 		}
 
-		const ColorRGB& operator*(const ColorRGB& c)
+		constexpr const ColorRGB& operator*(const ColorRGB& c)
 		{
 			return *this *= c;
 		}
 
-		ColorRGB operator*(const ColorRGB& c) const
+		constexpr ColorRGB operator*(const ColorRGB& c) const
 		{
 			return { r * c.r, g * c.g, b * c.b };
 		}
 
-		const ColorRGB& operator/=(const ColorRGB& c)
+		constexpr const ColorRGB& operator/=(const ColorRGB& c)
 		{
 			r /= c.r;
 			g /= c.g;
@@ -88,12 +90,12 @@ namespace dae
 			return *this;
 		}
 
-		const ColorRGB& operator/(const ColorRGB& c)
+		constexpr const ColorRGB& operator/(const ColorRGB& c)
 		{
 			return *this /= c;
 		}
 
-		const ColorRGB& operator*=(float s)
+		constexpr const ColorRGB& operator*=(float s)
 		{
 			r *= s;
 			g *= s;
@@ -102,17 +104,17 @@ namespace dae
 			return *this;
 		}
 
-		const ColorRGB& operator*(float s)
+		constexpr const ColorRGB& operator*(float s)
 		{
 			return *this *= s;
 		}
 
-		ColorRGB operator*(float s) const
+		constexpr ColorRGB operator*(float s) const
 		{
 			return { r * s, g * s,b * s };
 		}
 
-		const ColorRGB& operator/=(float s)
+		constexpr const ColorRGB& operator/=(float s)
 		{
 			r /= s;
 			g /= s;
@@ -121,7 +123,7 @@ namespace dae
 			return *this;
 		}
 
-		const ColorRGB& operator/(float s)
+		constexpr const ColorRGB& operator/(float s)
 		{
 			return *this /= s;
 		}
@@ -129,7 +131,7 @@ namespace dae
 	};
 
 	//ColorRGB (Global) Operators
-	inline ColorRGB operator*(float s, const ColorRGB& c)
+	constexpr ColorRGB operator*(float s, const ColorRGB& c)
 	{
 		return c * s;
 	}
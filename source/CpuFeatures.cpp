@@ -0,0 +1,128 @@
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "SIMD.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		struct CpuidRegisters
+		{
+			uint32_t eax{}, ebx{}, ecx{}, edx{};
+		};
+
+		CpuidRegisters Cpuid(uint32_t leaf, uint32_t subleaf = 0)
+		{
+			CpuidRegisters registers{};
+#if defined(_MSC_VER)
+			int values[4]{};
+			__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+			registers = { static_cast<uint32_t>(values[0]), static_cast<uint32_t>(values[1]), static_cast<uint32_t>(values[2]), static_cast<uint32_t>(values[3]) };
+#else
+			__cpuid_count(leaf, subleaf, registers.eax, registers.ebx, registers.ecx, registers.edx);
+#endif
+			return registers;
+		}
+
+		// register state the OS saves on a context switch (XCR0)
+		uint64_t GetEnabledRegisterState()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			uint32_t eax{}, edx{};
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+		}
+
+		bool HasBit(uint32_t value, int bit)
+		{
+			return (value >> bit) & 1u;
+		}
+
+		SimdLevel DetectSimdLevel()
+		{
+			const uint32_t maxLeaf{ Cpuid(0).eax };
+			const CpuidRegisters leaf1{ Cpuid(1) };
+
+			// xgetbv can only be used when the OS enabled it
+			const bool hasOSXSave{ HasBit(leaf1.ecx, 27) };
+			const uint64_t registerState{ hasOSXSave ? GetEnabledRegisterState() : 0 };
+
+			// SSE + AVX (bits 1, 2), AVX-512 adds the opmask and upper zmm registers (bits 5, 6, 7)
+			constexpr uint64_t avxState{ 0x6 };
+			constexpr uint64_t avx512State{ 0xE6 };
+
+			// SSE4.1 (bit 19)
+			if (!HasBit(leaf1.ecx, 19))
+				return SimdLevel::SSE2;
+
+			if (maxLeaf < 7 || !HasBit(leaf1.ecx, 28) || !HasBit(leaf1.ecx, 12) || (registerState & avxState) != avxState)
+				return SimdLevel::SSE4;
+
+			const CpuidRegisters leaf7{ Cpuid(7) };
+			if (!HasBit(leaf7.ebx, 5))
+				return SimdLevel::SSE4;
+
+			if (!HasBit(leaf7.ebx, 16) || (registerState & avx512State) != avx512State)
+				return SimdLevel::AVX2;
+
+			return SimdLevel::AVX512;
+		}
+	}
+
+	SimdLevel CpuFeatures::GetSupportedSimdLevel()
+	{
+		static const SimdLevel supportedLevel{ DetectSimdLevel() };
+		return supportedLevel;
+	}
+
+	SimdLevel CpuFeatures::GetCompiledSimdLevel()
+	{
+		// every level has its own Kernels_*.cpp, compiled for it whatever the rest of the build targets
+		return SimdLevel::AVX512;
+	}
+
+	SimdLevel CpuFeatures::GetUsableSimdLevel(SimdLevel requestedLevel)
+	{
+		return std::min({ requestedLevel, GetSupportedSimdLevel(), GetCompiledSimdLevel() });
+	}
+
+	const char* CpuFeatures::ToString(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::AVX2:
+			return "avx2";
+		case SimdLevel::AVX512:
+			return "avx512";
+		case SimdLevel::SSE4:
+			return "sse4";
+		default:
+			return "sse2";
+		}
+	}
+
+	bool CpuFeatures::FromString(const std::string& name, SimdLevel& level)
+	{
+		for (const SimdLevel candidate : { SimdLevel::SSE2, SimdLevel::SSE4, SimdLevel::AVX2, SimdLevel::AVX512 })
+		{
+			if (name == ToString(candidate))
+			{
+				level = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+}
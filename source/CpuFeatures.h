@@ -0,0 +1,42 @@
+#pragma once
+
+//Standard includes
+#include <string>
+
+namespace dae
+{
+	// instruction sets the packet kernels come in, from narrow to wide (4, 4, 8 and 16 rays per packet)
+	enum class SimdLevel
+	{
+		SSE2 = 0, // every x64 CPU
+		SSE4 = 1,
+		AVX2 = 2,
+		AVX512 = 3
+	};
+
+	/**
+	 * \brief CPUID based detection of what the hot kernels are allowed to run on.
+	 * Everything gets detected once, the first time it's asked for.
+	 */
+	namespace CpuFeatures
+	{
+		// widest level the CPU and OS support (the OS has to save the wide registers on a context switch)
+		SimdLevel GetSupportedSimdLevel();
+
+		// widest level this build has kernels for
+		SimdLevel GetCompiledSimdLevel();
+
+		// rays (and pixels) the kernels of a level work on at once
+		constexpr int GetPacketWidth(SimdLevel level)
+		{
+			return (level == SimdLevel::AVX512) ? 16 : (level == SimdLevel::AVX2) ? 8 : 4;
+		}
+
+		// widest level that is both supported and compiled, a lower requested level is respected (for testing the narrow kernels)
+		SimdLevel GetUsableSimdLevel(SimdLevel requestedLevel = SimdLevel::AVX512);
+
+		const char* ToString(SimdLevel level);
+		// "sse2", "sse4", "avx2" or "avx512"
+		bool FromString(const std::string& name, SimdLevel& level);
+	}
+}
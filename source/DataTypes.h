@@ -1,7 +1,15 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <memory>
+#include <span>
+#include <thread>
 
 #include "Math.h"
+#include "MappedFile.h"
+#include "SIMD.h"
 #include "vector"
 
 namespace dae
@@ -13,6 +21,7 @@ namespace dae
 		float radius{};
 
 		unsigned char materialIndex{ 0 };
+		uint32_t objectId{ 0 };
 	};
 
 	struct Plane
@@ -21,6 +30,7 @@ namespace dae
 		Vector3 normal{};
 
 		unsigned char materialIndex{ 0 };
+		uint32_t objectId{ 0 };
 	};
 
 	enum class TriangleCullMode
@@ -62,14 +72,87 @@ namespace dae
 		unsigned int leftNode{};
 		unsigned int firstTriIdx{};
 		unsigned int triCount{};
-		bool IsLeaf() { return triCount > 0; };
+		bool IsLeaf() const { return triCount > 0; };
+	};
+
+	// The binary BVH collapsed into a tree with up to WideBVHWidth children per node.
+	// Child bounds are stored per axis (SoA) so one SIMD slab test handles all children of a node.
+	constexpr int WideBVHWidth{ simd::PacketWidth };
+
+	// The builders stop splitting at this depth (the node becomes a leaf with more triangles), so the traversals can use fixed stacks.
+	// Depth first, a binary traversal keeps at most one sibling per level waiting, a wide one at most WideBVHWidth - 1.
+	constexpr unsigned int BVHMaxDepth{ 48 };
+	constexpr int BVHStackSize{ BVHMaxDepth + 1 };
+	constexpr int WideBVHStackSize{ BVHMaxDepth * (WideBVHWidth - 1) + 1 };
+
+	// a refitted tree gets rebuilt once its SAH cost is this many times the cost right after the build
+	constexpr float BVHRebuildThreshold{ 1.3f };
+
+	struct WideBVHNode
+	{
+		alignas(sizeof(float) * WideBVHWidth) float minX[WideBVHWidth]{};
+		alignas(sizeof(float) * WideBVHWidth) float minY[WideBVHWidth]{};
+		alignas(sizeof(float) * WideBVHWidth) float minZ[WideBVHWidth]{};
+		alignas(sizeof(float) * WideBVHWidth) float maxX[WideBVHWidth]{};
+		alignas(sizeof(float) * WideBVHWidth) float maxY[WideBVHWidth]{};
+		alignas(sizeof(float) * WideBVHWidth) float maxZ[WideBVHWidth]{};
+
+		unsigned int child[WideBVHWidth]{}; // inner child -> index of the wide node, leaf -> first index of its triangles
+		unsigned int triCount[WideBVHWidth]{}; // 0 for inner children, same unit as BVHNode::triCount
+		int childCount{};
+	};
+
+	// Triangles of a mesh in BVH leaf order (same order as TriangleMesh::normals), one array per component.
+	// Leaf tests read WideBVHWidth triangles at once without going through the index buffer.
+	// The components are stored back to back (ComponentCount arrays of paddedCount floats), in storage or in a mapped mesh file.
+	struct LeafTriangles
+	{
+		static constexpr size_t ComponentCount{ 12 };
+
+		const float* v0X{}, * v0Y{}, * v0Z{};
+		const float* edge1X{}, * edge1Y{}, * edge1Z{};
+		const float* edge2X{}, * edge2Y{}, * edge2Z{};
+		const float* normalX{}, * normalY{}, * normalZ{};
+
+		size_t paddedCount{};
+		std::vector<float> storage{};
+
+		// padded, a SIMD load starting at the last triangle stays inside the arrays
+		static size_t GetPaddedCount(size_t triangleCount) { return triangleCount + WideBVHWidth; }
+
+		void Resize(size_t triangleCount)
+		{
+			storage.resize(GetPaddedCount(triangleCount) * ComponentCount);
+			SetData(storage.data(), GetPaddedCount(triangleCount));
+		}
+
+		void SetData(const float* pData, size_t _paddedCount)
+		{
+			paddedCount = _paddedCount;
+			for (const float** ppComponent : { &v0X, &v0Y, &v0Z, &edge1X, &edge1Y, &edge1Z, &edge2X, &edge2Y, &edge2Z, &normalX, &normalY, &normalZ })
+			{
+				*ppComponent = pData;
+				pData += paddedCount;
+			}
+		}
+
+		// only for triangles living in storage
+		void Set(size_t triangle, const Vector3& v0, const Vector3& edge1, const Vector3& edge2, const Vector3& normal)
+		{
+			float* pData{ storage.data() + triangle };
+			for (const float component : { v0.x, v0.y, v0.z, edge1.x, edge1.y, edge1.z, edge2.x, edge2.y, edge2.z, normal.x, normal.y, normal.z })
+			{
+				*pData = component;
+				pData += paddedCount;
+			}
+		}
 	};
 	
 
 	struct aabb
 	{
 		Vector3 bMin{ Vector3::MaxFloat };
-		Vector3 bMax{ Vector3::MinFloat };
+		Vector3 bMax{ -Vector3::MaxFloat }; // MinFloat is the smallest positive float, it would clamp negative coordinates
 		void Grow(const Vector3& p)
 		{
 			bMin = Vector3::Min(bMin, p);
@@ -96,73 +179,108 @@ namespace dae
 
 	};
 
+	// Top level BVH (over whole scene objects), the leaves point to a sphere or a mesh instance (which has its own BVH)
+	enum class TopLevelPrimitiveType : unsigned char
+	{
+		Sphere,
+		TriangleMeshInstance
+	};
+
+	struct TopLevelPrimitive
+	{
+		Vector3 minAABB{};
+		Vector3 maxAABB{};
+		Vector3 centroid{};
+
+		TopLevelPrimitiveType type{};
+		unsigned int index{}; // index in the geometry vector of the scene matching the type
+	};
+
+	struct TopLevelBVHNode
+	{
+		Vector3 minAABB{};
+		Vector3 maxAABB{};
+		unsigned int leftNode{};
+		unsigned int firstPrimIdx{};
+		unsigned int primCount{};
+		bool IsLeaf() const { return primCount > 0; };
+	};
+
+	// How the mesh BVH follows changes to the (object space) vertices every UpdateBVH
+	enum class BVHUpdateMode
+	{
+		Rebuild, // full binned SAH build every update
+		Refit // keep the tree, only recompute the bounds (rebuilds when the quality drops too much)
+	};
+
+	// How TriangleMesh::BuildBVH creates the tree
+	enum class BVHBuildMethod
+	{
+		BinnedSAH, // best tree, slowest build
+		LBVH // triangles sorted along a Morton curve, a lot faster to build (meant for meshes that get rebuilt every frame)
+	};
+
+	// Geometry + BVH in object space, placed in the world by one or more TriangleMeshInstances
 	struct TriangleMesh
 	{
 		TriangleMesh() = default;
-		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, TriangleCullMode _cullMode):
-		positions(_positions), indices(_indices), cullMode(_cullMode)
+		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices):
+		positions(_positions), indices(_indices)
 		{
 			//Calculate Normals
 			CalculateNormals();
 
-			//Update Transforms
-			UpdateTransforms();
+			BuildBVH();
 		}
 
-		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, const std::vector<Vector3>& _normals, TriangleCullMode _cullMode) :
-			positions(_positions), indices(_indices), normals(_normals), cullMode(_cullMode)
+		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, const std::vector<Vector3>& _normals) :
+			positions(_positions), indices(_indices), normals(_normals)
 		{
-			UpdateTransforms();
+			BuildBVH();
 		}
 
-		~TriangleMesh()
-		{
-			delete[] pBvhNodes;
-		}
+		// instances and the traversal views point into the mesh, it stays where the scene put it
+		TriangleMesh(const TriangleMesh&) = delete;
+		TriangleMesh(TriangleMesh&&) noexcept = delete;
+		TriangleMesh& operator=(const TriangleMesh&) = delete;
+		TriangleMesh& operator=(TriangleMesh&&) noexcept = delete;
 
 		std::vector<Vector3> positions{};
 		std::vector<Vector3> normals{};
 		std::vector<int> indices{};
-		unsigned char materialIndex{};
-
-		TriangleCullMode cullMode{TriangleCullMode::BackFaceCulling};
-
-		Matrix rotationTransform{};
-		Matrix translationTransform{};
-		Matrix scaleTransform{};
-
-		Vector3 minAABB;
-		Vector3 maxAABB;
-
-		Vector3 transformedMinAABB;
-		Vector3 transformedMaxAABB;
-
-		std::vector<Vector3> transformedPositions{};
-		std::vector<Vector3> transformedNormals{};
-
 
-
-		BVHNode* pBvhNodes{};
+		std::vector<BVHNode> bvhNodes{};
 		unsigned int rootNodeIdx{};
 		unsigned int nodesUsed{};
+		unsigned int bvhIndexCount{}; // amount of indices the current tree was built for
 
+		// traversal copy of bvhNodes, rebuilt from it after every build/refit (root is node 0)
+		std::vector<WideBVHNode> wideBvhNodes{};
+		LeafTriangles leafTriangles{};
 
-		void Translate(const Vector3& translation)
-		{
-			translationTransform = Matrix::CreateTranslation(translation);
-		}
+		// What the traversal reads, UpdateTraversalData points these at the arrays above.
+		// A mesh loaded with MeshFile::Load points them straight into the mapped file instead and keeps it alive through pMappedFile,
+		// such a mesh has no positions/indices/bvhNodes of its own and can't be updated.
+		std::span<const BVHNode> bvhNodeView{};
+		std::span<const WideBVHNode> wideBvhNodeView{};
+		std::span<const Vector3> normalView{};
+		std::shared_ptr<const MappedFile> pMappedFile{};
 
-		void RotateY(float yaw)
-		{
-			rotationTransform = Matrix::CreateRotationY(yaw);
-		}
+		// upper limit for bvhBinCount, keeps the bins on the stack
+		static constexpr int MaxBVHBins{ 64 };
 
-		void Scale(const Vector3& scale)
-		{
-			scaleTransform = Matrix::CreateScale(scale);
-		}
+		int bvhBinCount{ 8 }; // SAH bins per axis, there are bvhBinCount - 1 split candidates
+		unsigned int bvhMaxLeafTriangles{ 2 }; // nodes with this many triangles or less are never split
+		unsigned int bvhParallelThreshold{ 4096 }; // nodes with more triangles than this get built with multiple threads
+
+		BVHBuildMethod bvhBuildMethod{ BVHBuildMethod::BinnedSAH };
+		BVHUpdateMode bvhUpdateMode{ BVHUpdateMode::Refit };
+		float bvhRebuildThreshold{ BVHRebuildThreshold };
+		float builtSAHCost{};
+		uint32_t bvhVersion{}; // bumped by every BuildBVH/RefitBVH, the scene compares it to notice deformed meshes
 
-		void AppendTriangle(const Triangle& triangle, bool ignoreTransformUpdate = false)
+
+		void AppendTriangle(const Triangle& triangle, bool ignoreBVHUpdate = false)
 		{
 			int startIndex = static_cast<int>(positions.size());
 
@@ -176,9 +294,9 @@ namespace dae
 
 			normals.push_back(triangle.normal);
 
-			//Not ideal, but making sure all vertices are updated
-			if(!ignoreTransformUpdate)
-				UpdateTransforms();
+			//Not ideal, but making sure the tree contains the new triangle
+			if(!ignoreBVHUpdate)
+				UpdateBVH();
 		}
 
 		void CalculateNormals()
@@ -203,125 +321,371 @@ namespace dae
 			}
 		}
 
+		// Call after changing the vertices, instances using this mesh need an UpdateTransforms to pick up the new bounds
+		void UpdateBVH()
+		{
+			if (pMappedFile != nullptr)
+				return;
 
-		void UpdateTransforms()
+			// the topology changed (or there is no tree yet), refitting is not possible
+			if (bvhUpdateMode == BVHUpdateMode::Rebuild || bvhNodes.empty() || bvhIndexCount != indices.size())
+			{
+				BuildBVH();
+				return;
+			}
+
+			RefitBVH();
+
+			// the tree stays valid, but deforming vertices keep on growing the boxes
+			if (CalculateSAHCost() > builtSAHCost * bvhRebuildThreshold)
+			{
+				BuildBVH();
+				return;
+			}
+
+			UpdateTraversalData();
+		}
+
+		void UpdateNodeBounds(unsigned int nodeIdx)
 		{
-			//Calculate Final Transform 
-			const auto finalTransform = scaleTransform * rotationTransform * translationTransform; // TRS matrix
+			BVHNode& node = bvhNodes[nodeIdx];
 
-			// preps the vector 
-			transformedNormals.clear();
-			transformedPositions.clear();
-			transformedPositions.reserve(positions.size());
-			transformedNormals.reserve(normals.size());
-			
-			// transform both and store them at the right index
-			for (const auto& position: positions)
+			node.minAABB = Vector3::MaxFloat;
+			node.maxAABB = -Vector3::MaxFloat; // MinFloat is the smallest positive float, it would clamp negative coordinates
+
+			// for each vertex, take min/max
+			for (unsigned int i{ 0 }; i < node.triCount; ++i) 
 			{
-				transformedPositions.emplace_back(finalTransform.TransformPoint(position));
+				node.minAABB = Vector3::Min(node.minAABB, positions[indices[node.firstTriIdx + i]]);
+				node.maxAABB = Vector3::Max(node.maxAABB, positions[indices[node.firstTriIdx + i]]);
 			}
-			for (const auto& normal : normals)
+		}
+
+		void BuildBVH()
+		{
+			if (indices.empty())
+				return;
+
+			// a binary tree with N leaves never has more than 2N - 1 nodes
+			if (bvhNodes.empty() || bvhIndexCount != indices.size())
 			{
-				transformedNormals.emplace_back(finalTransform.TransformVector(normal).Normalized());
+				bvhNodes.assign((indices.size() / 3) * 2, BVHNode{});
+				bvhIndexCount = static_cast<unsigned int>(indices.size());
 			}
 
-			//UpdateTransformedAABB(finalTransform);
+			BVHNode& root = bvhNodes[rootNodeIdx];
+			root.leftNode = 0;
+			root.firstTriIdx = 0;
+			root.triCount = static_cast<unsigned int>(indices.size());
 
-			nodesUsed = 0;
-			BuildBVH();
+			UpdateNodeBounds(rootNodeIdx);
+
+			switch (bvhBuildMethod)
+			{
+			case BVHBuildMethod::BinnedSAH:
+			{
+				// subtrees can be built on other threads, so the nodes get handed out through an atomic
+				std::atomic<unsigned int> lastNodeIdx{ rootNodeIdx };
+				Subdivide(rootNodeIdx, 0, lastNodeIdx, std::max(std::thread::hardware_concurrency(), 1u));
+				nodesUsed = lastNodeIdx.load();
+			}
+				break;
+			case BVHBuildMethod::LBVH:
+				BuildLBVH();
+				break;
+			}
+
+			builtSAHCost = CalculateSAHCost();
+			++bvhVersion;
+
+			UpdateTraversalData();
 		}
 
-		void UpdateAABB()
+		// wide BVH + leaf triangles, both derived from bvhNodes and the (sorted) index buffer
+		void UpdateTraversalData()
 		{
-			if (positions.size() > 0)
+			CollapseBVH();
+			UpdateLeafTriangles();
+
+			bvhNodeView = { bvhNodes.data(), !bvhNodes.empty() ? nodesUsed + 1 : 0 };
+			wideBvhNodeView = wideBvhNodes;
+			normalView = normals;
+		}
+
+		void UpdateLeafTriangles()
+		{
+			// Subdivide sorts the index buffer per leaf, so plain triangle order already is leaf order
+			const size_t triangleCount{ indices.size() / 3 };
+			leafTriangles.Resize(triangleCount);
+
+			for (size_t i{ 0 }; i < triangleCount; ++i)
 			{
-				minAABB = positions[0];
-				maxAABB = positions[0];
-				for (auto& p : positions)
+				const Vector3& v0{ positions[indices[i * 3]] };
+				const Vector3 edge1{ positions[indices[i * 3 + 1]] - v0 };
+				const Vector3 edge2{ positions[indices[i * 3 + 2]] - v0 };
+
+				leafTriangles.Set(i, v0, edge1, edge2, normals[i]);
+			}
+		}
+
+		void CollapseBVH()
+		{
+			wideBvhNodes.clear();
+			if (bvhNodes.empty())
+				return;
+
+			// every wide node replaces at least one binary inner node
+			wideBvhNodes.reserve(nodesUsed / 2 + 1);
+			wideBvhNodes.emplace_back();
+			CollapseNode(rootNodeIdx, 0);
+		}
+
+		void CollapseNode(unsigned int nodeIdx, unsigned int wideNodeIdx)
+		{
+			// start from the two children and keep opening the biggest inner child until the wide node is full
+			unsigned int children[WideBVHWidth]{};
+			int childCount{ 0 };
+
+			const BVHNode& node = bvhNodes[nodeIdx];
+			if (node.IsLeaf())
+			{
+				// only happens when the root itself is a leaf
+				children[childCount++] = nodeIdx;
+			}
+			else
+			{
+				children[childCount++] = node.leftNode;
+				children[childCount++] = node.leftNode + 1;
+			}
+
+			while (childCount < WideBVHWidth)
+			{
+				int biggestChild{ -1 };
+				float biggestArea{ -1.f };
+				for (int i{ 0 }; i < childCount; ++i)
 				{
-					minAABB = Vector3::Min(p, minAABB);
-					maxAABB = Vector3::Max(p, maxAABB);
+					const BVHNode& child = bvhNodes[children[i]];
+					if (child.IsLeaf())
+						continue;
+
+					const Vector3 extent{ child.maxAABB - child.minAABB };
+					const float area{ extent.x * extent.y + extent.y * extent.z + extent.z * extent.x };
+					if (area > biggestArea)
+					{
+						biggestArea = area;
+						biggestChild = i;
+					}
 				}
+
+				// only leaves left
+				if (biggestChild == -1)
+					break;
+
+				const unsigned int openedLeftNode{ bvhNodes[children[biggestChild]].leftNode };
+				children[biggestChild] = openedLeftNode;
+				children[childCount++] = openedLeftNode + 1;
+			}
+
+			// no references into wideBvhNodes here, the recursion below grows the vector
+			wideBvhNodes[wideNodeIdx].childCount = childCount;
+			for (int i{ 0 }; i < childCount; ++i)
+			{
+				const BVHNode& child = bvhNodes[children[i]];
+
+				WideBVHNode& wideNode = wideBvhNodes[wideNodeIdx];
+				wideNode.minX[i] = child.minAABB.x;
+				wideNode.minY[i] = child.minAABB.y;
+				wideNode.minZ[i] = child.minAABB.z;
+				wideNode.maxX[i] = child.maxAABB.x;
+				wideNode.maxY[i] = child.maxAABB.y;
+				wideNode.maxZ[i] = child.maxAABB.z;
+				wideNode.triCount[i] = child.triCount;
+
+				if (child.IsLeaf())
+				{
+					wideNode.child[i] = child.firstTriIdx;
+					continue;
+				}
+
+				const unsigned int childWideNodeIdx{ static_cast<unsigned int>(wideBvhNodes.size()) };
+				wideNode.child[i] = childWideNodeIdx;
+				wideBvhNodes.emplace_back();
+				CollapseNode(children[i], childWideNodeIdx);
 			}
 		}
 
-		void UpdateTransformedAABB(const Matrix& finalTransform)
+		void RefitBVH()
 		{
-			// AABB update: be careful -> transform the 8 vertices of the aabb
-			// and calculate new min and max.
-			Vector3 tMinAABB = finalTransform.TransformPoint(minAABB);
-			Vector3 tMaxAABB = tMinAABB;
-			// (xmax, ymin, zmin)
-			Vector3 tAABB = finalTransform.TransformPoint(maxAABB.x, minAABB.y, minAABB.z);
-			tMinAABB = Vector3::Min(tAABB, tMinAABB);
-			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
-			// (xmax, ymin, zmax)
-			tAABB = finalTransform.TransformPoint(maxAABB.x, minAABB.y, maxAABB.z);
-			tMinAABB = Vector3::Min(tAABB, tMinAABB);
-			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
-			// (xmin, ymin, zmax)
-			tAABB = finalTransform.TransformPoint(minAABB.x, minAABB.y, maxAABB.z);
-			tMinAABB = Vector3::Min(tAABB, tMinAABB);
-			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
-			// (xmin, ymax, zmin)
-			tAABB = finalTransform.TransformPoint(minAABB.x, maxAABB.y, minAABB.z);
-			tMinAABB = Vector3::Min(tAABB, tMinAABB);
-			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
-			// (xmax, ymax, zmin)
-			tAABB = finalTransform.TransformPoint(maxAABB.x, maxAABB.y, minAABB.z);
-			tMinAABB = Vector3::Min(tAABB, tMinAABB);
-			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
-			// (xmax, ymax, zmax)
-			tAABB = finalTransform.TransformPoint(maxAABB);
-			tMinAABB = Vector3::Min(tAABB, tMinAABB);
-			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
-			// (xmin, ymax, zmax)
-			tAABB = finalTransform.TransformPoint(minAABB.x, maxAABB.y, maxAABB.z);
-			tMinAABB = Vector3::Min(tAABB, tMinAABB);
-			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+			// children always get a higher index than their parent, walking backwards visits them first
+			for (int nodeIdx{ static_cast<int>(nodesUsed) }; nodeIdx >= 0; --nodeIdx)
+			{
+				BVHNode& node = bvhNodes[nodeIdx];
+				if (node.IsLeaf())
+				{
+					UpdateNodeBounds(nodeIdx);
+					continue;
+				}
 
-			transformedMinAABB = tMinAABB;
-			transformedMaxAABB = tMaxAABB;
+				const BVHNode& leftChild = bvhNodes[node.leftNode];
+				const BVHNode& rightChild = bvhNodes[node.leftNode + 1];
+				node.minAABB = Vector3::Min(leftChild.minAABB, rightChild.minAABB);
+				node.maxAABB = Vector3::Max(leftChild.maxAABB, rightChild.maxAABB);
+			}
 
+			++bvhVersion;
 		}
 
-		
+		float CalculateSAHCost() const
+		{
+			// SAH cost of the whole tree relative to the root: nodes * traversal cost + leaves * triangle count
+			const float traversalCost{ 1.f };
+			float cost{};
+			for (unsigned int nodeIdx{ 0 }; nodeIdx <= nodesUsed; ++nodeIdx)
+			{
+				const BVHNode& node = bvhNodes[nodeIdx];
+				const Vector3 extent{ node.maxAABB - node.minAABB };
+				const float surfaceArea{ extent.x * extent.y + extent.y * extent.z + extent.z * extent.x };
+
+				cost += surfaceArea * (node.triCount > 0 ? static_cast<float>(node.triCount / 3) : traversalCost);
+			}
+
+			const BVHNode& root = bvhNodes[rootNodeIdx];
+			const Vector3 rootExtent{ root.maxAABB - root.minAABB };
+			const float rootArea{ rootExtent.x * rootExtent.y + rootExtent.y * rootExtent.z + rootExtent.z * rootExtent.x };
+			return rootArea > 0 ? cost / rootArea : 0.f;
+		}
 
 
-		void UpdateNodeBounds(unsigned int nodeIdx)
+		void BuildLBVH()
 		{
-			BVHNode& node = pBvhNodes[nodeIdx];
+			const unsigned int triangleCount{ static_cast<unsigned int>(indices.size() / 3) };
+			const BVHNode& root = bvhNodes[rootNodeIdx];
+			const unsigned int numChunks{ triangleCount > bvhParallelThreshold ? std::max(std::thread::hardware_concurrency(), 1u) : 1 };
 
-			node.minAABB = Vector3::MaxFloat;
-			node.maxAABB = Vector3::MinFloat;
+			// centroid bounds, the Morton grid gets stretched over these
+			std::vector<aabb> chunkBounds(numChunks);
+			ForEachTriangleChunk(root, numChunks, [&](unsigned int chunkIdx, unsigned int firstIdx, unsigned int endIdx)
+				{
+					for (unsigned int i{ firstIdx }; i < endIdx; i += 3)
+					{
+						chunkBounds[chunkIdx].Grow((positions[indices[i]] + positions[indices[i + 1]] + positions[indices[i + 2]]) / 3.0f);
+					}
+				});
 
-			// for each vertex, take min/max
-			for (unsigned int i{ 0 }; i < node.triCount; ++i) 
+			aabb centroidBounds{};
+			for (const aabb& bounds : chunkBounds)
 			{
-				node.minAABB = Vector3::Min(node.minAABB, transformedPositions[indices[node.firstTriIdx + i]]);
-				node.maxAABB = Vector3::Max(node.maxAABB, transformedPositions[indices[node.firstTriIdx + i]]);
+				centroidBounds.Grow(bounds);
 			}
+
+			const Vector3 extent{ centroidBounds.bMax - centroidBounds.bMin };
+			const Vector3 scale{ extent.x > 0 ? 1023.f / extent.x : 0.f, extent.y > 0 ? 1023.f / extent.y : 0.f, extent.z > 0 ? 1023.f / extent.z : 0.f };
+
+			std::vector<uint32_t> mortonCodes(triangleCount);
+			std::vector<uint32_t> triangleOrder(triangleCount);
+			ForEachTriangleChunk(root, numChunks, [&](unsigned int, unsigned int firstIdx, unsigned int endIdx)
+				{
+					for (unsigned int i{ firstIdx }; i < endIdx; i += 3)
+					{
+						const Vector3 gridPos{ ((positions[indices[i]] + positions[indices[i + 1]] + positions[indices[i + 2]]) / 3.0f - centroidBounds.bMin) };
+						mortonCodes[i / 3] = MortonCode(static_cast<uint32_t>(gridPos.x * scale.x), static_cast<uint32_t>(gridPos.y * scale.y), static_cast<uint32_t>(gridPos.z * scale.z));
+						triangleOrder[i / 3] = i / 3;
+					}
+				});
+
+			RadixSortMortonCodes(mortonCodes, triangleOrder);
+
+			// put the triangles in curve order, every subtree is a contiguous range of them after this
+			std::vector<int> sortedIndices(indices.size());
+			std::vector<Vector3> sortedNormals(triangleCount);
+			for (unsigned int i{ 0 }; i < triangleCount; ++i)
+			{
+				const unsigned int triangle{ triangleOrder[i] };
+				sortedIndices[i * 3] = indices[triangle * 3];
+				sortedIndices[i * 3 + 1] = indices[triangle * 3 + 1];
+				sortedIndices[i * 3 + 2] = indices[triangle * 3 + 2];
+				sortedNormals[i] = normals[triangle];
+			}
+			indices.swap(sortedIndices);
+			normals.swap(sortedNormals);
+
+			nodesUsed = rootNodeIdx;
+			EmitLBVHNode(rootNodeIdx, 0, 0, triangleCount, mortonCodes);
+
+			// only the leaves know their triangles yet, refitting fills in all the bounds bottom up
+			RefitBVH();
 		}
 
-		void BuildBVH()
+		void EmitLBVHNode(unsigned int nodeIdx, unsigned int depth, unsigned int firstTriangle, unsigned int triangleCount, const std::vector<uint32_t>& mortonCodes)
 		{
-			BVHNode& root = pBvhNodes[rootNodeIdx];
-			root.leftNode = 0;
-			root.firstTriIdx = 0;
-			root.triCount = static_cast<unsigned int>(indices.size());
+			BVHNode& node = bvhNodes[nodeIdx];
+			node.firstTriIdx = firstTriangle * 3;
+			node.triCount = triangleCount * 3;
+			if (triangleCount <= bvhMaxLeafTriangles || depth >= BVHMaxDepth) return;
 
-			UpdateNodeBounds(rootNodeIdx);
+			// split where the highest bit that differs inside the range flips, the codes are sorted so everything before it has that bit cleared
+			const uint32_t firstCode{ mortonCodes[firstTriangle] };
+			const uint32_t lastCode{ mortonCodes[firstTriangle + triangleCount - 1] };
 
-			Subdivide(rootNodeIdx);
+			unsigned int splitTriangle{ firstTriangle + triangleCount / 2 }; // all codes the same -> just cut the range in half
+			if (firstCode != lastCode)
+			{
+				const uint32_t splitBit{ 1u << (31 - std::countl_zero(firstCode ^ lastCode)) };
+				const auto rangeBegin{ mortonCodes.begin() + firstTriangle };
+				const auto rangeEnd{ rangeBegin + triangleCount };
+				splitTriangle = static_cast<unsigned int>(std::partition_point(rangeBegin, rangeEnd, [splitBit](uint32_t code) { return (code & splitBit) == 0; }) - mortonCodes.begin());
+			}
+
+			// create child nodes, always next to each other and after their parent
+			const unsigned int leftChildIdx{ ++nodesUsed };
+			const unsigned int rightChildIdx{ ++nodesUsed };
+			node.leftNode = leftChildIdx;
+			node.triCount = 0;
 
+			EmitLBVHNode(leftChildIdx, depth + 1, firstTriangle, splitTriangle - firstTriangle, mortonCodes);
+			EmitLBVHNode(rightChildIdx, depth + 1, splitTriangle, firstTriangle + triangleCount - splitTriangle, mortonCodes);
 		}
 
+		// LSD radix sort on the 30 bit codes, 8 bits per pass, the triangle indices move along with their code
+		static void RadixSortMortonCodes(std::vector<uint32_t>& mortonCodes, std::vector<uint32_t>& triangleOrder)
+		{
+			std::vector<uint32_t> tempCodes(mortonCodes.size());
+			std::vector<uint32_t> tempOrder(triangleOrder.size());
+
+			for (int shift{ 0 }; shift < 32; shift += 8)
+			{
+				unsigned int offsets[256]{};
+				for (const uint32_t code : mortonCodes)
+				{
+					++offsets[(code >> shift) & 0xFF];
+				}
+
+				unsigned int sum{ 0 };
+				for (unsigned int& offset : offsets)
+				{
+					const unsigned int count{ offset };
+					offset = sum;
+					sum += count;
+				}
+
+				for (size_t i{ 0 }; i < mortonCodes.size(); ++i)
+				{
+					const unsigned int destination{ offsets[(mortonCodes[i] >> shift) & 0xFF]++ };
+					tempCodes[destination] = mortonCodes[i];
+					tempOrder[destination] = triangleOrder[i];
+				}
+
+				mortonCodes.swap(tempCodes);
+				triangleOrder.swap(tempOrder);
+			}
+		}
 
-		void Subdivide(unsigned int nodeIdx)
+		// numThreads -> threads this subtree may use, gets split over both children when they're both big enough
+		void Subdivide(unsigned int nodeIdx, unsigned int depth, std::atomic<unsigned int>& lastNodeIdx, unsigned int numThreads)
 		{
 			// terminate recursion
-			BVHNode& node = pBvhNodes[nodeIdx];
-			if (node.triCount <= 8) return; // test number
+			BVHNode& node = bvhNodes[nodeIdx];
+			if (node.triCount <= bvhMaxLeafTriangles * 3 || depth >= BVHMaxDepth) return;
 			
 			// the tutorial I followed had 3 different parts to this solution, with each part giving more performance
 			// uncomment 1 part while keeping the rest commented should let you work with the old stuff
@@ -343,7 +707,7 @@ namespace dae
 			{
 				for (unsigned int i{0}; i < node.triCount / 3; ++i)
 				{
-					const Vector3 centroid{ (transformedPositions[indices[i * 3]] + transformedPositions[indices[i * 3 + 1]] + transformedPositions[indices[i * 3 + 2]]) * 0.3333f };
+					const Vector3 centroid{ (positions[indices[i * 3]] + positions[indices[i * 3 + 1]] + positions[indices[i * 3 + 2]]) * 0.3333f };
 
 					const float candidatePos{ centroid[axis] };
 					const float cost{ EvaluateSAH(node, axis, candidatePos) };
@@ -361,7 +725,7 @@ namespace dae
 			// part 3
 			int axis{ };
 			float splitPos{ };
-			float splitCost{ FindBestSplitPlane(node, axis, splitPos) };
+			float splitCost{ FindBestSplitPlane(node, axis, splitPos, numThreads) };
 			const float noSplitCost{ CalculateNodeCost(node) };
 			if (splitCost >= noSplitCost) return;
 
@@ -376,8 +740,8 @@ namespace dae
 			int j{ i + static_cast<int>(node.triCount) - 1 };
 			while (i <= j)
 			{
-				//calculate centroid of current triangle
-				const Vector3 centroid{ (transformedPositions[indices[i]] + transformedPositions[indices[i + 1]] + transformedPositions[indices[i + 2]]) * 0.3333f };
+				//calculate centroid of current triangle, same as the binning does
+				const Vector3 centroid{ (positions[indices[i]] + positions[indices[i + 1]] + positions[indices[i + 2]]) / 3.0f };
 				if (centroid[axis] < splitPos)
 				{
 					i += 3;
@@ -389,29 +753,40 @@ namespace dae
 					std::swap(indices[i + 2], indices[j]);
 
 					std::swap(normals[i / 3], normals[(j - 2) / 3]);
-					std::swap(transformedNormals[i / 3], transformedNormals[(j - 2) / 3]);
 
 					j -= 3;
 				}
 			}
 			// abort split of one of the sides is empty
-			int leftCount{ i - static_cast<int>(node.firstTriIdx) };
+			// i never ends up before the first triangle of the node
+			const unsigned int leftCount{ static_cast<unsigned int>(i) - node.firstTriIdx };
 			if (leftCount == 0 || leftCount == node.triCount) return;
-			// create child nodes
-			int leftChildIdx{ static_cast<int>(++nodesUsed)};
-			int rightChildIdx{ static_cast<int>(++nodesUsed)};
+			// create child nodes, always next to each other and after their parent
+			const unsigned int leftChildIdx{ lastNodeIdx.fetch_add(2) + 1 };
+			const unsigned int rightChildIdx{ leftChildIdx + 1 };
+			const unsigned int rightCount{ node.triCount - leftCount };
 			node.leftNode = leftChildIdx;
-			pBvhNodes[leftChildIdx].firstTriIdx = node.firstTriIdx;
-			pBvhNodes[leftChildIdx].triCount = leftCount;
-			pBvhNodes[rightChildIdx].firstTriIdx = i;
-			pBvhNodes[rightChildIdx].triCount = node.triCount - leftCount;
+			bvhNodes[leftChildIdx].firstTriIdx = node.firstTriIdx;
+			bvhNodes[leftChildIdx].triCount = leftCount;
+			bvhNodes[rightChildIdx].firstTriIdx = i;
+			bvhNodes[rightChildIdx].triCount = rightCount;
 			node.triCount = 0;
 			UpdateNodeBounds(leftChildIdx);
 			UpdateNodeBounds(rightChildIdx);
-			// recurse
-			Subdivide(leftChildIdx);
-			Subdivide(rightChildIdx);
 
+			// recurse, both children work on their own part of the index buffer, so big ones can be built at the same time
+			const bool buildInParallel{ numThreads > 1 && leftCount / 3 > bvhParallelThreshold && rightCount / 3 > bvhParallelThreshold };
+			if (buildInParallel)
+			{
+				std::thread leftBuilder{ [this, leftChildIdx, depth, &lastNodeIdx, numThreads] { Subdivide(leftChildIdx, depth + 1, lastNodeIdx, numThreads / 2); } };
+				Subdivide(rightChildIdx, depth + 1, lastNodeIdx, numThreads - numThreads / 2);
+				leftBuilder.join();
+			}
+			else
+			{
+				Subdivide(leftChildIdx, depth + 1, lastNodeIdx, numThreads);
+				Subdivide(rightChildIdx, depth + 1, lastNodeIdx, numThreads);
+			}
 		}
 
 
@@ -425,9 +800,9 @@ namespace dae
 
 			for (unsigned int i{ 0 }; i < node.triCount; i += 3)
 			{
-				const Vector3 v0{ transformedPositions[indices[i]] };
-				const Vector3 v1{ transformedPositions[indices[i + 1]] };
-				const Vector3 v2{ transformedPositions[indices[i + 2]] };
+				const Vector3 v0{ positions[indices[i]] };
+				const Vector3 v1{ positions[indices[i + 1]] };
+				const Vector3 v2{ positions[indices[i + 2]] };
 				const Vector3 centroid{ (v0 + v1 + v2) * 0.3333f };
 
 				if (centroid[axis] < pos)
@@ -452,49 +827,137 @@ namespace dae
 
 
 
-		float FindBestSplitPlane(const BVHNode& node, int& axis, float& splitPos)
+		// Splits the triangles of a node over numChunks threads, task(chunkIdx, firstIdx, endIdx) works on the index entries [firstIdx, endIdx)
+		template<typename Task>
+		void ForEachTriangleChunk(const BVHNode& node, unsigned int numChunks, const Task& task) const
 		{
-			float bestCost{ FLT_MAX };
-			for (int currAxis{ 0 }; currAxis < 3; ++currAxis)
+			const uint64_t triangleCount{ node.triCount / 3 };
+
+			std::vector<std::thread> threads{};
+			threads.reserve(numChunks - 1);
+			for (unsigned int chunkIdx{ 0 }; chunkIdx < numChunks; ++chunkIdx)
 			{
-				float boundsMin{FLT_MAX};
-				float boundsMax{FLT_MIN};
-				for (unsigned int i{0}; i < node.triCount; i += 3)
+				const unsigned int firstIdx{ node.firstTriIdx + static_cast<unsigned int>(triangleCount * chunkIdx / numChunks) * 3 };
+				const unsigned int endIdx{ node.firstTriIdx + static_cast<unsigned int>(triangleCount * (chunkIdx + 1) / numChunks) * 3 };
+
+				// the calling thread takes the last chunk
+				if (chunkIdx == numChunks - 1)
+					task(chunkIdx, firstIdx, endIdx);
+				else
+					threads.emplace_back([&task, chunkIdx, firstIdx, endIdx] { task(chunkIdx, firstIdx, endIdx); });
+			}
+
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		}
+
+		float FindBestSplitPlane(const BVHNode& node, int& axis, float& splitPos, unsigned int numThreads = 1)
+		{
+			const int nrOfBins{ std::clamp(bvhBinCount, 2, MaxBVHBins) };
+
+			// the big nodes at the top of the tree get their centroid bounds + bins gathered by multiple threads
+			const unsigned int numChunks{ (numThreads > 1 && node.triCount / 3 > bvhParallelThreshold) ? numThreads : 1 };
+
+			// bounds of the centroids, the bins are spread over these
+			aabb centroidBounds{};
+			auto growCentroidBounds = [this](unsigned int firstIdx, unsigned int endIdx, aabb& bounds)
+			{
+				for (unsigned int i{ firstIdx }; i < endIdx; i += 3)
 				{
-					const Vector3 centroid{ (transformedPositions[indices[node.firstTriIdx + i]] + transformedPositions[indices[node.firstTriIdx + i + 1]] + transformedPositions[indices[node.firstTriIdx + i + 2]]) / 3.0f };
-					boundsMin = std::min(boundsMin, centroid[currAxis]);
-					boundsMax = std::max(boundsMax, centroid[currAxis]);
+					bounds.Grow((positions[indices[i]] + positions[indices[i + 1]] + positions[indices[i + 2]]) / 3.0f);
 				}
-				
-
-				if (boundsMin == boundsMax) continue;
-				// populate the bins
-				const int nrOfBins{ 8 };
-				Bin bin[nrOfBins];
-				float scale{ nrOfBins / (boundsMax - boundsMin)  };
+			};
 
+			if (numChunks == 1)
+			{
+				growCentroidBounds(node.firstTriIdx, node.firstTriIdx + node.triCount, centroidBounds);
+			}
+			else
+			{
+				std::vector<aabb> chunkBounds(numChunks);
+				ForEachTriangleChunk(node, numChunks, [&](unsigned int chunkIdx, unsigned int firstIdx, unsigned int endIdx)
+					{
+						growCentroidBounds(firstIdx, endIdx, chunkBounds[chunkIdx]);
+					});
 
+				for (const aabb& bounds : chunkBounds)
+				{
+					centroidBounds.Grow(bounds);
+				}
+			}
 
-				for (unsigned int i{0}; i < node.triCount; i += 3)
+			// populate the bins, all 3 axes in one go
+			struct BinSet
+			{
+				Bin bins[3][MaxBVHBins];
+			};
+			const Vector3 boundsMin{ centroidBounds.bMin };
+			const Vector3 boundsMax{ centroidBounds.bMax };
+			const Vector3 extent{ boundsMax - boundsMin };
+			const Vector3 scale{ extent.x > 0 ? nrOfBins / extent.x : 0.f, extent.y > 0 ? nrOfBins / extent.y : 0.f, extent.z > 0 ? nrOfBins / extent.z : 0.f };
+
+			auto binTriangles = [&](unsigned int firstIdx, unsigned int endIdx, BinSet& binSet)
+			{
+				for (unsigned int i{ firstIdx }; i < endIdx; i += 3)
 				{
-					const Vector3& v0{ transformedPositions[indices[node.firstTriIdx + i]] };
-					const Vector3& v1{ transformedPositions[indices[node.firstTriIdx + i + 1]] };
-					const Vector3& v2{ transformedPositions[indices[node.firstTriIdx + i + 2]] };
+					const Vector3& v0{ positions[indices[i]] };
+					const Vector3& v1{ positions[indices[i + 1]] };
+					const Vector3& v2{ positions[indices[i + 2]] };
 					const Vector3 centroid{ (v0 + v1 + v2) / 3.0f };
 
-					const int binIdx{ std::min(nrOfBins - 1, static_cast<int>((centroid[currAxis] - boundsMin) * scale)) };
+					for (int currAxis{ 0 }; currAxis < 3; ++currAxis)
+					{
+						const int binIdx{ std::min(nrOfBins - 1, static_cast<int>((centroid[currAxis] - boundsMin[currAxis]) * scale[currAxis])) };
 
-					bin[binIdx].triCount += 3;
-					bin[binIdx].bounds.Grow(v0);
-					bin[binIdx].bounds.Grow(v1);
-					bin[binIdx].bounds.Grow(v2);
+						Bin& bin{ binSet.bins[currAxis][binIdx] };
+						bin.triCount += 3;
+						bin.bounds.Grow(v0);
+						bin.bounds.Grow(v1);
+						bin.bounds.Grow(v2);
+					}
 				}
+			};
 
-				// gather data for the 7 planes between the 8 bins
-				float leftArea[nrOfBins - 1]{};
-				float rightArea[nrOfBins - 1]{};
-				int leftCount[nrOfBins - 1]{};
-				int rightCount[nrOfBins - 1]{};
+			BinSet binSet{};
+			if (numChunks == 1)
+			{
+				binTriangles(node.firstTriIdx, node.firstTriIdx + node.triCount, binSet);
+			}
+			else
+			{
+				std::vector<BinSet> chunkBins(numChunks);
+				ForEachTriangleChunk(node, numChunks, [&](unsigned int chunkIdx, unsigned int firstIdx, unsigned int endIdx)
+					{
+						binTriangles(firstIdx, endIdx, chunkBins[chunkIdx]);
+					});
+
+				for (const BinSet& chunk : chunkBins)
+				{
+					for (int currAxis{ 0 }; currAxis < 3; ++currAxis)
+					{
+						for (int i{ 0 }; i < nrOfBins; ++i)
+						{
+							binSet.bins[currAxis][i].triCount += chunk.bins[currAxis][i].triCount;
+							binSet.bins[currAxis][i].bounds.Grow(chunk.bins[currAxis][i].bounds);
+						}
+					}
+				}
+			}
+
+			float bestCost{ FLT_MAX };
+			for (int currAxis{ 0 }; currAxis < 3; ++currAxis)
+			{
+				if (boundsMin[currAxis] == boundsMax[currAxis]) continue;
+
+				const Bin* bin{ binSet.bins[currAxis] };
+
+				// gather data for the planes between the bins
+				float leftArea[MaxBVHBins - 1]{};
+				float rightArea[MaxBVHBins - 1]{};
+				int leftCount[MaxBVHBins - 1]{};
+				int rightCount[MaxBVHBins - 1]{};
 
 
 				aabb leftBox;
@@ -515,19 +978,18 @@ namespace dae
 					rightArea[nrOfBins - 2 - i] = rightBox.Area();
 				}
 
-				scale = (boundsMax - boundsMin) / nrOfBins;
+				const float binWidth{ (boundsMax[currAxis] - boundsMin[currAxis]) / nrOfBins };
 				for (int i{0}; i < nrOfBins - 1; ++i)
 				{
 					const float planeCost{ leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i] };
 					if (planeCost < bestCost)
 					{
 						axis = currAxis;
-						splitPos = boundsMin + scale * (i + 1);
+						splitPos = boundsMin[currAxis] + binWidth * (i + 1);
 						bestCost = planeCost;
 					}
 				}
 			}
-
 			return bestCost;
 		}
 
@@ -540,6 +1002,97 @@ namespace dae
 		}
 
 	};
+
+	// Places a (shared) TriangleMesh in the world, rays get transformed into object space instead of transforming the vertices
+	struct TriangleMeshInstance
+	{
+		const TriangleMesh* pMesh{};
+
+		unsigned char materialIndex{};
+		uint32_t objectId{};
+		TriangleCullMode cullMode{ TriangleCullMode::BackFaceCulling };
+
+		Matrix rotationTransform{};
+		Matrix translationTransform{};
+		Matrix scaleTransform{};
+
+		Matrix objectToWorld{};
+		Matrix worldToObject{};
+		Matrix normalToWorld{}; // inverse transpose, keeps normals perpendicular under non-uniform scale
+
+		// world space bounds, used by the top level BVH
+		Vector3 minAABB{};
+		Vector3 maxAABB{};
+
+		void Translate(const Vector3& translation)
+		{
+			translationTransform = Matrix::CreateTranslation(translation);
+		}
+
+		void RotateY(float yaw)
+		{
+			rotationTransform = Matrix::CreateRotationY(yaw);
+		}
+
+		void Scale(const Vector3& scale)
+		{
+			scaleTransform = Matrix::CreateScale(scale);
+		}
+
+		void UpdateTransforms()
+		{
+			//Calculate Final Transform 
+			objectToWorld = scaleTransform * rotationTransform * translationTransform; // TRS matrix
+			worldToObject = Matrix::Inverse(objectToWorld);
+			normalToWorld = Matrix::Transpose(worldToObject);
+
+			UpdateAABB();
+		}
+
+		void UpdateAABB()
+		{
+			// the root of the mesh BVH holds the object space bounds
+			const BVHNode& root{ pMesh->bvhNodeView[pMesh->rootNodeIdx] };
+			const Vector3& objMinAABB{ root.minAABB };
+			const Vector3& objMaxAABB{ root.maxAABB };
+
+			// AABB update: be careful -> transform the 8 vertices of the aabb
+			// and calculate new min and max.
+			Vector3 tMinAABB = objectToWorld.TransformPoint(objMinAABB);
+			Vector3 tMaxAABB = tMinAABB;
+			// (xmax, ymin, zmin)
+			Vector3 tAABB = objectToWorld.TransformPoint(objMaxAABB.x, objMinAABB.y, objMinAABB.z);
+			tMinAABB = Vector3::Min(tAABB, tMinAABB);
+			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+			// (xmax, ymin, zmax)
+			tAABB = objectToWorld.TransformPoint(objMaxAABB.x, objMinAABB.y, objMaxAABB.z);
+			tMinAABB = Vector3::Min(tAABB, tMinAABB);
+			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+			// (xmin, ymin, zmax)
+			tAABB = objectToWorld.TransformPoint(objMinAABB.x, objMinAABB.y, objMaxAABB.z);
+			tMinAABB = Vector3::Min(tAABB, tMinAABB);
+			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+			// (xmin, ymax, zmin)
+			tAABB = objectToWorld.TransformPoint(objMinAABB.x, objMaxAABB.y, objMinAABB.z);
+			tMinAABB = Vector3::Min(tAABB, tMinAABB);
+			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+			// (xmax, ymax, zmin)
+			tAABB = objectToWorld.TransformPoint(objMaxAABB.x, objMaxAABB.y, objMinAABB.z);
+			tMinAABB = Vector3::Min(tAABB, tMinAABB);
+			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+			// (xmax, ymax, zmax)
+			tAABB = objectToWorld.TransformPoint(objMaxAABB);
+			tMinAABB = Vector3::Min(tAABB, tMinAABB);
+			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+			// (xmin, ymax, zmax)
+			tAABB = objectToWorld.TransformPoint(objMinAABB.x, objMaxAABB.y, objMaxAABB.z);
+			tMinAABB = Vector3::Min(tAABB, tMinAABB);
+			tMaxAABB = Vector3::Max(tAABB, tMaxAABB);
+
+			minAABB = tMinAABB;
+			maxAABB = tMaxAABB;
+		}
+	};
 #pragma endregion
 #pragma region LIGHT
 	enum class LightType
@@ -577,6 +1130,43 @@ namespace dae
 
 		bool didHit{ false };
 		unsigned char materialIndex{ 0 };
+
+		// which surface got hit: the scene object + the triangle of a mesh (0 for spheres and planes)
+		uint32_t objectId{ 0 };
+		uint32_t primitiveIndex{ 0 };
+	};
+
+	// N coherent rays in SoA layout, traced together through the packet hit tests
+	template<int N>
+	struct RayPacket
+	{
+		simd::vfloat<N> originX, originY, originZ;
+		simd::vfloat<N> directionX, directionY, directionZ;
+		simd::vfloat<N> inverseDirectionX, inverseDirectionY, inverseDirectionZ;
+
+		simd::vfloat<N> min{ 0.0001f };
+
+		// all rays share the sign of their direction components -> they want to visit the BVH in the same order
+		bool IsCoherent() const
+		{
+			constexpr int fullMask{ simd::FullMask<N>() };
+			const simd::vfloat<N> zero{ simd::vfloat<N>::Zero() };
+			const int signX{ MoveMask(directionX < zero) };
+			const int signY{ MoveMask(directionY < zero) };
+			const int signZ{ MoveMask(directionZ < zero) };
+			return (signX == 0 || signX == fullMask) && (signY == 0 || signY == fullMask) && (signZ == 0 || signZ == fullMask);
+		}
+
+		Vector3 GetOrigin(int lane) const { return { originX[lane], originY[lane], originZ[lane] }; }
+		Vector3 GetDirection(int lane) const { return { directionX[lane], directionY[lane], directionZ[lane] }; }
+	};
+
+	// closest t of every lane in a register (for culling) + the full record per lane
+	template<int N>
+	struct PacketHitRecord
+	{
+		simd::vfloat<N> t{ FLT_MAX };
+		HitRecord hits[N]{};
 	};
 #pragma endregion
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "FrameBuffer.h"
+
+using namespace dae;
+
+void FrameBuffer::Resize(uint32_t width, uint32_t height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_SampleCount = 0;
+
+	const size_t numPixels{ static_cast<size_t>(width) * height };
+	m_Red.assign(numPixels, 0.f);
+	m_Green.assign(numPixels, 0.f);
+	m_Blue.assign(numPixels, 0.f);
+
+	m_HistoryRed.assign(numPixels, 0.f);
+	m_HistoryGreen.assign(numPixels, 0.f);
+	m_HistoryBlue.assign(numPixels, 0.f);
+}
+
+void FrameBuffer::StoreHistory()
+{
+	m_Red.swap(m_HistoryRed);
+	m_Green.swap(m_HistoryGreen);
+	m_Blue.swap(m_HistoryBlue);
+
+	// the planes hold sums while accumulating
+	if (m_SampleCount > 1)
+	{
+		const float scale{ 1.f / static_cast<float>(m_SampleCount) };
+		for (size_t i{ 0 }; i < m_HistoryRed.size(); ++i)
+		{
+			m_HistoryRed[i] *= scale;
+			m_HistoryGreen[i] *= scale;
+			m_HistoryBlue[i] *= scale;
+		}
+	}
+}
+
+void FrameBuffer::SelectResolveKernels()
+{
+	const ResolveKernels* pKernels{};
+	switch (m_SimdLevel)
+	{
+	case SimdLevel::AVX512:
+		pKernels = &GetResolveKernels<SimdLevel::AVX512>();
+		break;
+	case SimdLevel::AVX2:
+		pKernels = &GetResolveKernels<SimdLevel::AVX2>();
+		break;
+	case SimdLevel::SSE4:
+		pKernels = &GetResolveKernels<SimdLevel::SSE4>();
+		break;
+	default:
+		pKernels = &GetResolveKernels<SimdLevel::SSE2>();
+		break;
+	}
+
+	m_pResolveRows = pKernels->rows[static_cast<int>(m_ToneMapping)][m_IsSRGBEnabled];
+	m_pResolveScaledRows = pKernels->scaledRows[static_cast<int>(m_ToneMapping)][m_IsSRGBEnabled];
+}
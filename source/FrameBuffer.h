@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "ColorRGB.h"
+#include "CpuFeatures.h"
+
+namespace dae
+{
+	enum class ToneMapping
+	{
+		MaxToOne = 0, // divides by the largest channel when that's above one, keeps the hue
+		Reinhard = 1, // c / (1 + c) per channel
+		ACES = 2 // Narkowicz' fit of the ACES filmic curve
+	};
+
+	// where the 8 bit channels go in a 32 bit display pixel
+	struct PixelLayout
+	{
+		uint32_t redShift{ 16 };
+		uint32_t greenShift{ 8 };
+		uint32_t blueShift{ 0 };
+		uint32_t alphaMask{ 0 };
+	};
+
+	/**
+	 * \brief HDR float framebuffer the renderer shades into, one plane per channel so Resolve can work on whole registers.
+	 * Every pixel accumulates one sample per frame until the history gets reset, Resolve averages them,
+	 * tone maps, applies the transfer curve and packs a block of it into 32 bit display pixels.
+	 * The resolve kernels are compiled once per instruction set (see Kernels.inl), the settings pick one.
+	 */
+	class FrameBuffer final
+	{
+	public:
+		FrameBuffer() { SelectResolveKernels(); }
+
+		void Resize(uint32_t width, uint32_t height);
+		uint32_t GetWidth() const { return m_Width; }
+		uint32_t GetHeight() const { return m_Height; }
+
+		// starts the next sample of every pixel, reset -> this sample replaces the history instead of adding to it
+		void BeginSample(bool reset) { m_SampleCount = reset ? 1 : m_SampleCount + 1; }
+		uint32_t GetSampleCount() const { return m_SampleCount; }
+
+		void AddSample(uint32_t pixelIndex, const ColorRGB& color)
+		{
+			if (m_SampleCount <= 1)
+			{
+				m_Red[pixelIndex] = color.r;
+				m_Green[pixelIndex] = color.g;
+				m_Blue[pixelIndex] = color.b;
+			}
+			else
+			{
+				m_Red[pixelIndex] += color.r;
+				m_Green[pixelIndex] += color.g;
+				m_Blue[pixelIndex] += color.b;
+			}
+		}
+
+		// average of the accumulated samples
+		ColorRGB GetPixel(uint32_t pixelIndex) const
+		{
+			const float scale{ 1.f / static_cast<float>(std::max(m_SampleCount, 1u)) };
+			return { m_Red[pixelIndex] * scale, m_Green[pixelIndex] * scale, m_Blue[pixelIndex] * scale };
+		}
+
+		// Keeps the current image (averaged) around as the previous frame, for reprojection.
+		// The planes keep stale values until the next frame overwrites them, every pixel has to get a new sample.
+		void StoreHistory();
+		ColorRGB GetHistoryPixel(uint32_t pixelIndex) const
+		{
+			return { m_HistoryRed[pixelIndex], m_HistoryGreen[pixelIndex], m_HistoryBlue[pixelIndex] };
+		}
+
+		// Tone maps, encodes and packs [startX, endX) x [startY, endY) into pDestination, which has the same width as this buffer
+		void Resolve(uint32_t* pDestination, uint32_t startX, uint32_t endX, uint32_t startY, uint32_t endY) const
+		{
+			(this->*m_pResolveRows)(pDestination, startX, endX, startY, endY);
+		}
+		// Same, but bilinearly scales this buffer up to a destinationWidth x destinationHeight image and writes its rows [startY, endY)
+		void ResolveScaled(uint32_t* pDestination, uint32_t destinationWidth, uint32_t destinationHeight, uint32_t startY, uint32_t endY) const
+		{
+			(this->*m_pResolveScaledRows)(pDestination, destinationWidth, destinationHeight, startY, endY);
+		}
+
+		void SetPixelLayout(const PixelLayout& layout) { m_PixelLayout = layout; }
+
+		void SetToneMapping(ToneMapping toneMapping) { m_ToneMapping = toneMapping; SelectResolveKernels(); }
+		ToneMapping GetToneMapping() const { return m_ToneMapping; }
+
+		// off -> the tone mapped values are written out linearly
+		void SetSRGBEnabled(bool isEnabled) { m_IsSRGBEnabled = isEnabled; SelectResolveKernels(); }
+		bool IsSRGBEnabled() const { return m_IsSRGBEnabled; }
+
+		// has to be usable, see CpuFeatures::GetUsableSimdLevel
+		void SetSimdLevel(SimdLevel level) { m_SimdLevel = level; SelectResolveKernels(); }
+
+	private:
+		// both kinds of resolve take the destination + 4 coordinates
+		using ResolveKernel = void (FrameBuffer::*)(uint32_t*, uint32_t, uint32_t, uint32_t, uint32_t) const;
+		// indexed with [ToneMapping][SRGB]
+		struct ResolveKernels
+		{
+			ResolveKernel rows[3][2];
+			ResolveKernel scaledRows[3][2];
+		};
+		template<SimdLevel Level>
+		static const ResolveKernels& GetResolveKernels();
+		void SelectResolveKernels();
+
+		template<SimdLevel Level, ToneMapping Mapping, bool SRGB>
+		void ResolveRows(uint32_t* pDestination, uint32_t startX, uint32_t endX, uint32_t startY, uint32_t endY) const;
+		template<SimdLevel Level, ToneMapping Mapping, bool SRGB>
+		void ResolveScaledRows(uint32_t* pDestination, uint32_t destinationWidth, uint32_t destinationHeight, uint32_t startY, uint32_t endY) const;
+		template<SimdLevel Level, ToneMapping Mapping, bool SRGB>
+		void ResolvePixels(const float* pRed, const float* pGreen, const float* pBlue, float scale, uint32_t* pDestination) const;
+
+		uint32_t m_Width{};
+		uint32_t m_Height{};
+		uint32_t m_SampleCount{};
+
+		std::vector<float> m_Red{};
+		std::vector<float> m_Green{};
+		std::vector<float> m_Blue{};
+
+		std::vector<float> m_HistoryRed{};
+		std::vector<float> m_HistoryGreen{};
+		std::vector<float> m_HistoryBlue{};
+
+		PixelLayout m_PixelLayout{};
+		ToneMapping m_ToneMapping{ ToneMapping::MaxToOne };
+		bool m_IsSRGBEnabled{ false };
+
+		SimdLevel m_SimdLevel{ CpuFeatures::GetUsableSimdLevel() };
+		ResolveKernel m_pResolveRows{};
+		ResolveKernel m_pResolveScaledRows{};
+	};
+}
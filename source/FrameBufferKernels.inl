@@ -0,0 +1,259 @@
+// Tone map + pack kernels of the FrameBuffer, only included by the Kernels_*.cpp files (see Kernels.inl).
+// Every kernel file gets its own copy of the helpers below, compiled for its instruction set.
+#include <array>
+#include <cmath>
+
+#include "FrameBuffer.h"
+#include "SIMD.h"
+
+namespace dae
+{
+	namespace
+	{
+		// linear [0, 1] -> 8 bit sRGB, indexed with value * (SRGBTableSize - 1)
+		constexpr uint32_t SRGBTableSize{ 4096 };
+
+		const std::array<uint8_t, SRGBTableSize>& GetSRGBTable()
+		{
+			static const std::array<uint8_t, SRGBTableSize> table{ []
+				{
+					std::array<uint8_t, SRGBTableSize> result{};
+					for (uint32_t i{ 0 }; i < SRGBTableSize; ++i)
+					{
+						const float linear{ static_cast<float>(i) / (SRGBTableSize - 1) };
+						const float encoded{ (linear <= 0.0031308f) ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f };
+						result[i] = static_cast<uint8_t>(encoded * 255.f + 0.5f);
+					}
+					return result;
+				}() };
+			return table;
+		}
+
+		template<ToneMapping Mapping, int N>
+		void ToneMap(simd::vfloat<N>& r, simd::vfloat<N>& g, simd::vfloat<N>& b)
+		{
+			using vfloat = simd::vfloat<N>;
+
+			const vfloat one{ 1.f };
+			if constexpr (Mapping == ToneMapping::MaxToOne)
+			{
+				// same as ColorRGB::MaxToOne
+				const vfloat maxValue{ Max(r, Max(g, b)) };
+				const vfloat isOver{ maxValue > one };
+				r = Select(isOver, r / maxValue, r);
+				g = Select(isOver, g / maxValue, g);
+				b = Select(isOver, b / maxValue, b);
+			}
+			else if constexpr (Mapping == ToneMapping::Reinhard)
+			{
+				r = r / (one + r);
+				g = g / (one + g);
+				b = b / (one + b);
+			}
+			else
+			{
+				const auto aces = [](vfloat x)
+					{
+						return (x * (vfloat{ 2.51f } * x + vfloat{ 0.03f })) / (x * (vfloat{ 2.43f } * x + vfloat{ 0.59f }) + vfloat{ 0.14f });
+					};
+				r = aces(r);
+				g = aces(g);
+				b = aces(b);
+			}
+		}
+
+		// [0, 1] float -> [0, 255], truncated to integers by Pack
+		template<bool SRGB, int N>
+		simd::vfloat<N> Encode(simd::vfloat<N> c)
+		{
+			using vfloat = simd::vfloat<N>;
+
+			// negative lobes of the BRDFs end up as black instead of wrapping around
+			c = Min(Max(c, vfloat::Zero()), vfloat{ 1.f });
+
+			if constexpr (SRGB)
+			{
+				alignas(64) float lanes[N];
+				(c * vfloat{ SRGBTableSize - 1.f } + vfloat{ 0.5f }).Store(lanes);
+
+				const std::array<uint8_t, SRGBTableSize>& table{ GetSRGBTable() };
+				for (int i{ 0 }; i < N; ++i)
+				{
+					lanes[i] = table[static_cast<uint32_t>(lanes[i])];
+				}
+				return vfloat::Load(lanes);
+			}
+			else
+			{
+				return c * vfloat{ 255.f };
+			}
+		}
+
+		// The shifts come from the display format, no per pixel SDL_MapRGB
+		inline void Pack(simd::vfloat<4> r, simd::vfloat<4> g, simd::vfloat<4> b, const PixelLayout& layout, uint32_t* pDestination)
+		{
+			const __m128i packed{ _mm_or_si128(_mm_or_si128(
+				_mm_sll_epi32(_mm_cvttps_epi32(r.v), _mm_cvtsi32_si128(static_cast<int>(layout.redShift))),
+				_mm_sll_epi32(_mm_cvttps_epi32(g.v), _mm_cvtsi32_si128(static_cast<int>(layout.greenShift)))),
+				_mm_or_si128(
+				_mm_sll_epi32(_mm_cvttps_epi32(b.v), _mm_cvtsi32_si128(static_cast<int>(layout.blueShift))),
+				_mm_set1_epi32(static_cast<int>(layout.alphaMask)))) };
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination), packed);
+		}
+
+#if defined(SIMD_AVX2_PACKETS)
+		inline void Pack(simd::vfloat<8> r, simd::vfloat<8> g, simd::vfloat<8> b, const PixelLayout& layout, uint32_t* pDestination)
+		{
+			const __m256i packed{ _mm256_or_si256(_mm256_or_si256(
+				_mm256_sll_epi32(_mm256_cvttps_epi32(r.v), _mm_cvtsi32_si128(static_cast<int>(layout.redShift))),
+				_mm256_sll_epi32(_mm256_cvttps_epi32(g.v), _mm_cvtsi32_si128(static_cast<int>(layout.greenShift)))),
+				_mm256_or_si256(
+				_mm256_sll_epi32(_mm256_cvttps_epi32(b.v), _mm_cvtsi32_si128(static_cast<int>(layout.blueShift))),
+				_mm256_set1_epi32(static_cast<int>(layout.alphaMask)))) };
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDestination), packed);
+		}
+#endif
+
+#if defined(SIMD_AVX512_PACKETS)
+		inline void Pack(simd::vfloat<16> r, simd::vfloat<16> g, simd::vfloat<16> b, const PixelLayout& layout, uint32_t* pDestination)
+		{
+			const __m512i packed{ _mm512_or_si512(_mm512_or_si512(
+				_mm512_sll_epi32(_mm512_cvttps_epi32(r.v), _mm_cvtsi32_si128(static_cast<int>(layout.redShift))),
+				_mm512_sll_epi32(_mm512_cvttps_epi32(g.v), _mm_cvtsi32_si128(static_cast<int>(layout.greenShift)))),
+				_mm512_or_si512(
+				_mm512_sll_epi32(_mm512_cvttps_epi32(b.v), _mm_cvtsi32_si128(static_cast<int>(layout.blueShift))),
+				_mm512_set1_epi32(static_cast<int>(layout.alphaMask)))) };
+
+			_mm512_storeu_si512(pDestination, packed);
+		}
+#endif
+	}
+
+	template<SimdLevel Level>
+	const FrameBuffer::ResolveKernels& FrameBuffer::GetResolveKernels()
+	{
+		static const ResolveKernels kernels{
+			{
+				{ &FrameBuffer::ResolveRows<Level, ToneMapping::MaxToOne, false>, &FrameBuffer::ResolveRows<Level, ToneMapping::MaxToOne, true> },
+				{ &FrameBuffer::ResolveRows<Level, ToneMapping::Reinhard, false>, &FrameBuffer::ResolveRows<Level, ToneMapping::Reinhard, true> },
+				{ &FrameBuffer::ResolveRows<Level, ToneMapping::ACES, false>, &FrameBuffer::ResolveRows<Level, ToneMapping::ACES, true> }
+			},
+			{
+				{ &FrameBuffer::ResolveScaledRows<Level, ToneMapping::MaxToOne, false>, &FrameBuffer::ResolveScaledRows<Level, ToneMapping::MaxToOne, true> },
+				{ &FrameBuffer::ResolveScaledRows<Level, ToneMapping::Reinhard, false>, &FrameBuffer::ResolveScaledRows<Level, ToneMapping::Reinhard, true> },
+				{ &FrameBuffer::ResolveScaledRows<Level, ToneMapping::ACES, false>, &FrameBuffer::ResolveScaledRows<Level, ToneMapping::ACES, true> }
+			} };
+		return kernels;
+	}
+
+	template<SimdLevel Level, ToneMapping Mapping, bool SRGB>
+	SIMD_KERNEL void FrameBuffer::ResolveRows(uint32_t* pDestination, uint32_t startX, uint32_t endX, uint32_t startY, uint32_t endY) const
+	{
+		constexpr uint32_t Width{ CpuFeatures::GetPacketWidth(Level) };
+
+		// the planes hold the sum of the samples
+		const float scale{ 1.f / static_cast<float>(std::max(m_SampleCount, 1u)) };
+
+		for (uint32_t py{ startY }; py < endY; ++py)
+		{
+			const uint32_t rowStart{ py * m_Width };
+
+			uint32_t px{ startX };
+			for (; px + Width <= endX; px += Width)
+			{
+				const uint32_t pixelIndex{ rowStart + px };
+				ResolvePixels<Level, Mapping, SRGB>(&m_Red[pixelIndex], &m_Green[pixelIndex], &m_Blue[pixelIndex], scale, &pDestination[pixelIndex]);
+			}
+
+			// the last few pixels of the row go through a padded copy, so they share the code path above
+			const uint32_t numRemaining{ endX - px };
+			if (numRemaining > 0)
+			{
+				float red[Width]{}, green[Width]{}, blue[Width]{};
+				uint32_t packed[Width]{};
+				for (uint32_t i{ 0 }; i < numRemaining; ++i)
+				{
+					red[i] = m_Red[rowStart + px + i];
+					green[i] = m_Green[rowStart + px + i];
+					blue[i] = m_Blue[rowStart + px + i];
+				}
+
+				ResolvePixels<Level, Mapping, SRGB>(red, green, blue, scale, packed);
+
+				for (uint32_t i{ 0 }; i < numRemaining; ++i)
+				{
+					pDestination[rowStart + px + i] = packed[i];
+				}
+			}
+		}
+	}
+
+	template<SimdLevel Level, ToneMapping Mapping, bool SRGB>
+	SIMD_KERNEL void FrameBuffer::ResolveScaledRows(uint32_t* pDestination, uint32_t destinationWidth, uint32_t destinationHeight, uint32_t startY, uint32_t endY) const
+	{
+		constexpr uint32_t Width{ CpuFeatures::GetPacketWidth(Level) };
+
+		const float scale{ 1.f / static_cast<float>(std::max(m_SampleCount, 1u)) };
+		const float stepX{ static_cast<float>(m_Width) / destinationWidth };
+		const float stepY{ static_cast<float>(m_Height) / destinationHeight };
+
+		for (uint32_t py{ startY }; py < endY; ++py)
+		{
+			// the pixel centers line up, the border pixels stretch over the edge
+			const float sourceY{ std::clamp((py + 0.5f) * stepY - 0.5f, 0.f, static_cast<float>(m_Height - 1)) };
+			const uint32_t y0{ static_cast<uint32_t>(sourceY) };
+			const uint32_t y1{ std::min(y0 + 1, m_Height - 1) };
+			const float fy{ sourceY - y0 };
+			const uint32_t row0{ y0 * m_Width };
+			const uint32_t row1{ y1 * m_Width };
+
+			const uint32_t rowStart{ py * destinationWidth };
+			for (uint32_t px{ 0 }; px < destinationWidth; px += Width)
+			{
+				// the filtered sums go through the same tone map and pack as the unscaled pixels
+				float red[Width]{}, green[Width]{}, blue[Width]{};
+				uint32_t packed[Width]{};
+				const uint32_t numPixels{ std::min(Width, destinationWidth - px) };
+				for (uint32_t i{ 0 }; i < numPixels; ++i)
+				{
+					const float sourceX{ std::clamp((px + i + 0.5f) * stepX - 0.5f, 0.f, static_cast<float>(m_Width - 1)) };
+					const uint32_t x0{ static_cast<uint32_t>(sourceX) };
+					const uint32_t x1{ std::min(x0 + 1, m_Width - 1) };
+					const float fx{ sourceX - x0 };
+
+					const float weights[4]{ (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy };
+					const uint32_t taps[4]{ row0 + x0, row0 + x1, row1 + x0, row1 + x1 };
+					for (int tap{ 0 }; tap < 4; ++tap)
+					{
+						red[i] += m_Red[taps[tap]] * weights[tap];
+						green[i] += m_Green[taps[tap]] * weights[tap];
+						blue[i] += m_Blue[taps[tap]] * weights[tap];
+					}
+				}
+
+				ResolvePixels<Level, Mapping, SRGB>(red, green, blue, scale, packed);
+
+				for (uint32_t i{ 0 }; i < numPixels; ++i)
+				{
+					pDestination[rowStart + px + i] = packed[i];
+				}
+			}
+		}
+	}
+
+	template<SimdLevel Level, ToneMapping Mapping, bool SRGB>
+	void FrameBuffer::ResolvePixels(const float* pRed, const float* pGreen, const float* pBlue, float scale, uint32_t* pDestination) const
+	{
+		using vfloat = simd::vfloat<CpuFeatures::GetPacketWidth(Level)>;
+
+		const vfloat average{ scale };
+		vfloat r{ vfloat::Load(pRed) * average };
+		vfloat g{ vfloat::Load(pGreen) * average };
+		vfloat b{ vfloat::Load(pBlue) * average };
+		ToneMap<Mapping>(r, g, b);
+
+		Pack(Encode<SRGB>(r), Encode<SRGB>(g), Encode<SRGB>(b), m_PixelLayout, pDestination);
+	}
+}
@@ -0,0 +1,17 @@
+// Shared body of the Kernels_*.cpp files, each one compiles the hot code for its own instruction set.
+// SIMD_KERNEL_LEVEL names the SimdLevel the including file was compiled for.
+#include "CpuFeatures.h"
+#include "SIMD.h"
+
+#include "FrameBufferKernels.inl"
+#include "SceneQueries.inl"
+#include "RendererKernels.inl"
+
+namespace dae
+{
+	constexpr SimdLevel KernelLevel{ SimdLevel::SIMD_KERNEL_LEVEL };
+
+	// everything else these tables point to gets instantiated through them
+	template const Renderer::TileKernels& Renderer::GetTileKernels<KernelLevel>();
+	template const FrameBuffer::ResolveKernels& FrameBuffer::GetResolveKernels<KernelLevel>();
+}
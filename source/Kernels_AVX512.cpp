@@ -0,0 +1,20 @@
+// The render, ray query and resolve kernels compiled for AVX512, picked at startup when the CPU has it (see CpuFeatures).
+// MSVC raises the target of this file with /arch:AVX512 in the project instead of the pragma.
+#include "SIMDBuild.h"
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx512f,avx2,fma")
+#endif
+#define SIMD_SSE4_PACKETS
+#define SIMD_AVX2_PACKETS
+#define SIMD_AVX512_PACKETS
+
+#define SIMD_ISA_NAMESPACE avx512
+#define SIMD_KERNEL_LEVEL AVX512
+#include "Kernels.inl"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
@@ -0,0 +1,6 @@
+// The render, ray query and resolve kernels compiled for plain SSE2, the fallback every x64 CPU can run (see CpuFeatures).
+#include "SIMDBuild.h"
+
+#define SIMD_ISA_NAMESPACE sse2
+#define SIMD_KERNEL_LEVEL SSE2
+#include "Kernels.inl"
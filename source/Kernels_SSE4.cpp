@@ -0,0 +1,18 @@
+// The render, ray query and resolve kernels compiled for SSE4, picked at startup when the CPU has it (see CpuFeatures).
+// MSVC has no /arch for SSE4.1, it only gets the SSE4.1 intrinsics the SIMD wrappers ask for (SIMD_SSE4_PACKETS) there.
+#include "SIMDBuild.h"
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("sse4.1")
+#endif
+#define SIMD_SSE4_PACKETS
+
+#define SIMD_ISA_NAMESPACE sse4
+#define SIMD_KERNEL_LEVEL SSE4
+#include "Kernels.inl"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
@@ -0,0 +1,144 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+MappedFile::MappedFile(const std::string& filename)
+{
+	Open(filename);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	Close();
+
+	m_pData = std::exchange(other.m_pData, nullptr);
+	m_Size = std::exchange(other.m_Size, 0);
+#if defined(_WIN32)
+	m_FileHandle = std::exchange(other.m_FileHandle, nullptr);
+	m_MappingHandle = std::exchange(other.m_MappingHandle, nullptr);
+#else
+	m_FileDescriptor = std::exchange(other.m_FileDescriptor, -1);
+#endif
+
+	return *this;
+}
+
+#if defined(_WIN32)
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	m_FileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_FileHandle == INVALID_HANDLE_VALUE)
+	{
+		m_FileHandle = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(m_FileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		// an empty file can't be mapped
+		Close();
+		return false;
+	}
+
+	m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_MappingHandle == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (m_pData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_Size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_MappingHandle)
+		CloseHandle(m_MappingHandle);
+	if (m_FileHandle)
+		CloseHandle(m_FileHandle);
+
+	m_pData = nullptr;
+	m_Size = 0;
+	m_MappingHandle = nullptr;
+	m_FileHandle = nullptr;
+}
+#else
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	m_FileDescriptor = open(filename.c_str(), O_RDONLY);
+	if (m_FileDescriptor == -1)
+		return false;
+
+	struct stat fileStats{};
+	if (fstat(m_FileDescriptor, &fileStats) != 0 || fileStats.st_size == 0)
+	{
+		// an empty file can't be mapped
+		Close();
+		return false;
+	}
+
+	void* pMapping{ mmap(nullptr, static_cast<size_t>(fileStats.st_size), PROT_READ, MAP_SHARED, m_FileDescriptor, 0) };
+	if (pMapping == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const char*>(pMapping);
+	m_Size = static_cast<size_t>(fileStats.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+		munmap(const_cast<char*>(m_pData), m_Size);
+	if (m_FileDescriptor != -1)
+		close(m_FileDescriptor);
+
+	m_pData = nullptr;
+	m_Size = 0;
+	m_FileDescriptor = -1;
+}
+#endif
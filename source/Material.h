@@ -1,149 +1,133 @@
 #pragma once
+#include <cstdint>
+
 #include "Math.h"
 #include "DataTypes.h"
 #include "BRDFs.h"
 
 namespace dae
 {
-#pragma region Material BASE
-	class Material
+	enum class MaterialType : uint8_t
 	{
-	public:
-		Material() = default;
-		virtual ~Material() = default;
-
-		Material(const Material&) = delete;
-		Material(Material&&) noexcept = delete;
-		Material& operator=(const Material&) = delete;
-		Material& operator=(Material&&) noexcept = delete;
-
-		/**
-		 * \brief Function used to calculate the correct color for the specific material and its parameters
-		 * \param hitRecord current hitrecord
-		 * \param l light direction
-		 * \param v view direction
-		 * \return color
-		 */
-		virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) = 0;
+		SolidColor,
+		Lambert,
+		LambertPhong,
+		CookTorrence
 	};
-#pragma endregion
 
-#pragma region Material SOLID COLOR
-	//SOLID COLOR
-	//===========
-	class Material_SolidColor final : public Material
+	/**
+	 * \brief One entry of the scene's material table: a type tag and the parameters of that type packed together.
+	 * No virtual functions, the scene keeps these by value in one array and the shading switches on the type,
+	 * code that already knows the type (a batch of hits sharing a material) can call Shade<Type> directly.
+	 * Everything that doesn't depend on the light or view direction is baked when the material gets created,
+	 * create a new one to change its parameters.
+	 */
+	struct Material
 	{
-	public:
-		Material_SolidColor(const ColorRGB& color): m_Color(color)
+		MaterialType type{ MaterialType::SolidColor };
+		// SolidColor: color | Lambert, LambertPhong: diffuse BRDF (kd * cd / pi) | CookTorrence: albedo / pi
+		ColorRGB color{ 1, 1, 1 };
+		// CookTorrence: base reflectivity f0
+		ColorRGB baseReflectivity{};
+
+		// LambertPhong: ks, phong exponent | CookTorrence: alpha^2, kDirect, metalness
+		float params[3]{};
+
+		static Material CreateSolidColor(const ColorRGB& color)
 		{
+			return { MaterialType::SolidColor, color };
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) override
+		static Material CreateLambert(const ColorRGB& diffuseColor, float diffuseReflectance)
 		{
-			return m_Color;
+			return { MaterialType::Lambert, BRDF::Lambert(diffuseReflectance, diffuseColor) };
 		}
 
-	private:
-		ColorRGB m_Color{colors::White};
-	};
-#pragma endregion
-
-#pragma region Material LAMBERT
-	//LAMBERT
-	//=======
-	class Material_Lambert final : public Material
-	{
-	public:
-		Material_Lambert(const ColorRGB& diffuseColor, float diffuseReflectance) :
-			m_DiffuseColor(diffuseColor), m_DiffuseReflectance(diffuseReflectance){}
-
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		static Material CreateLambertPhong(const ColorRGB& diffuseColor, float kd, float ks, float phongExponent)
 		{
-			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
+			return { MaterialType::LambertPhong, BRDF::Lambert(kd, diffuseColor), {}, { ks, phongExponent } };
 		}
 
-	private:
-		ColorRGB m_DiffuseColor{colors::White};
-		float m_DiffuseReflectance{1.f}; //kd
-	};
-#pragma endregion
-
-#pragma region Material LAMBERT PHONG
-	//LAMBERT-PHONG
-	//=============
-	class Material_LambertPhong final : public Material
-	{
-	public:
-		Material_LambertPhong(const ColorRGB& diffuseColor, float kd, float ks, float phongExponent):
-			m_DiffuseColor(diffuseColor), m_DiffuseReflectance(kd), m_SpecularReflectance(ks),
-			m_PhongExponent(phongExponent)
+		// roughness: [1.0 > 0.0] >> [ROUGH > SMOOTH]
+		static Material CreateCookTorrence(const ColorRGB& albedo, float metalness, float roughness)
 		{
+			// baseReflectivity is different for dielectrics and metals; metals get the Albedo value, dielectrics get the base value
+			const ColorRGB baseReflectivity{ (metalness == 0) ? ColorRGB{ 0.04f, 0.04f, 0.04f } : albedo };
+
+			return { MaterialType::CookTorrence, albedo * INV_PI, baseReflectivity,
+				{ BRDF::RoughnessToAlphaSquared(roughness), BRDF::RoughnessToKDirect(roughness), metalness } };
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		// the result of Shade changes with the view direction (specular highlights)
+		static constexpr bool IsViewDependent(MaterialType type)
 		{
-			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor)
-				+ BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, v, hitRecord.normal);
+			return type == MaterialType::LambertPhong || type == MaterialType::CookTorrence;
 		}
+		bool IsViewDependent() const { return IsViewDependent(type); }
 
-	private:
-		ColorRGB m_DiffuseColor{colors::White};
-		float m_DiffuseReflectance{0.5f}; //kd
-		float m_SpecularReflectance{0.5f}; //ks
-		float m_PhongExponent{1.f}; //Phong Exponent
-	};
-#pragma endregion
-
-#pragma region Material COOK TORRENCE
-	//COOK TORRENCE
-	class Material_CookTorrence final : public Material
-	{
-	public:
-		Material_CookTorrence(const ColorRGB& albedo, float metalness, float roughness):
-			m_Albedo(albedo), m_Metalness(metalness), m_Roughness(roughness)
+		/**
+		 * \brief Function used to calculate the correct color for the specific material and its parameters
+		 * \param hitRecord current hitrecord
+		 * \param l light direction
+		 * \param v view direction
+		 * \return color
+		 */
+		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
 		{
+			switch (type)
+			{
+			case MaterialType::Lambert:
+				return Shade<MaterialType::Lambert>(hitRecord, l, v);
+			case MaterialType::LambertPhong:
+				return Shade<MaterialType::LambertPhong>(hitRecord, l, v);
+			case MaterialType::CookTorrence:
+				return Shade<MaterialType::CookTorrence>(hitRecord, l, v);
+			default:
+				return Shade<MaterialType::SolidColor>(hitRecord, l, v);
+			}
 		}
 
-		ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) override
+		template<MaterialType Type>
+		ColorRGB Shade(const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const
 		{
-			// to get this to work, we first need to calculate DFG ( Fresnel_Schlik, Trowbridge-Reitz GGX, NormalDistribution_GGX)
-
-			const Vector3 halfVector{ (l - v).Normalized() }; // half vector between view direction and light direction -> normalized
-			const ColorRGB baseReflectivity{ (m_Metalness == 0) ? ColorRGB{0.04f, 0.04f, 0.04f } : m_Albedo }; // short hand if else: variable = (condition) ? expressionTrue : expressionFalse;
-			// baseReflectivity is different for dielectrics and metals; metals get the Albedo value, dielectrics get the base value
+			// the Lambert BRDF doesn't depend on the directions, it got baked into the color
+			if constexpr (Type == MaterialType::SolidColor || Type == MaterialType::Lambert)
+			{
+				return color;
+			}
+			else if constexpr (Type == MaterialType::LambertPhong)
+			{
+				return color + BRDF::Phong(params[0], params[1], l, v, hitRecord.normal);
+			}
+			else
+			{
+				const float alphaSqrd{ params[0] };
+				const float kDirect{ params[1] };
+				const float metalness{ params[2] };
 
-			// f
-			const ColorRGB fresnelSchlick{ BRDF::FresnelFunction_Schlick(halfVector, -v, baseReflectivity) };
-			// d
-			const float normalDistribution{ BRDF::NormalDistribution_GGX(hitRecord.normal, halfVector, m_Roughness) };
-			// g
-			const float geometryFunction{ BRDF::GeometryFunction_Smith(hitRecord.normal, -v, l, m_Roughness) };
+				// to get this to work, we first need to calculate DFG ( Fresnel_Schlik, Trowbridge-Reitz GGX, NormalDistribution_GGX)
 
-			const float divisor{ 4 * Vector3::Dot(-v,hitRecord.normal) * Vector3::Dot(l,hitRecord.normal) };
+				const Vector3 halfVector{ (l - v).Normalized() }; // half vector between view direction and light direction -> normalized
 
+				// f
+				const ColorRGB fresnelSchlick{ BRDF::FresnelFunction_Schlick(halfVector, -v, baseReflectivity) };
+				// d
+				const float normalDistribution{ BRDF::NormalDistribution_GGX(hitRecord.normal, halfVector, alphaSqrd) };
+				// g
+				const float geometryFunction{ BRDF::GeometryFunction_Smith(hitRecord.normal, -v, l, kDirect) };
 
+				const float divisor{ 4 * Vector3::Dot(-v,hitRecord.normal) * Vector3::Dot(l,hitRecord.normal) };
 
+				ColorRGB specular{ fresnelSchlick * normalDistribution * geometryFunction };
+				specular /= divisor;
 
-			ColorRGB specular{ fresnelSchlick * normalDistribution * geometryFunction };
-			specular / divisor; // the ColorRGB / operator changes to /=
+				// metals have no diffuse part
+				if (metalness != 0)
+					return specular;
 
-			ColorRGB lambert{};
-			if (m_Metalness == 0)
-			{
-				lambert = BRDF::Lambert({ 1.f - fresnelSchlick.r, 1.f - fresnelSchlick.g, 1.f - fresnelSchlick.b }, m_Albedo);
+				const ColorRGB lambert{ color * ColorRGB{ 1.f - fresnelSchlick.r, 1.f - fresnelSchlick.g, 1.f - fresnelSchlick.b } };
+				return specular + lambert;
 			}
-			else
-			{
-				lambert = BRDF::Lambert(0, m_Albedo);
-			}
-
-			return specular + lambert;
 		}
-
-	private:
-		ColorRGB m_Albedo{0.955f, 0.637f, 0.538f}; //Copper
-		float m_Metalness{1.0f};
-		float m_Roughness{0.1f}; // [1.0 > 0.0] >> [ROUGH > SMOOTH]
 	};
-#pragma endregion
 }
@@ -1,5 +1,13 @@
 #pragma once
+#include <cfloat>
 #include <cmath>
+#include <cstdint>
+
+// the 4 wide math (Vector4, Matrix) uses SSE when the target has it, plain scalar code otherwise
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_USE_SSE
+#include <immintrin.h>
+#endif
 
 namespace dae
 {
@@ -15,12 +23,12 @@ namespace dae
 	constexpr auto TO_DEGREES = (180.0f / PI);
 	constexpr auto TO_RADIANS(PI / 180.0f);
 
-	inline float Square(float a)
+	constexpr float Square(float a)
 	{
 		return a * a;
 	}
 
-	inline float Lerpf(float a, float b, float factor)
+	constexpr float Lerpf(float a, float b, float factor)
 	{
 		return ((1 - factor) * a) + (factor * b);
 	}
@@ -29,4 +37,20 @@ namespace dae
 	{
 		return abs(a - b) < epsilon;
 	}
+
+	// spreads the lower 10 bits of v out so there are 2 zero bits between each of them
+	inline uint32_t ExpandBits(uint32_t v)
+	{
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	// 30 bit Morton code of a point in [0, 1023]^3 (bits of x, y and z interleaved)
+	inline uint32_t MortonCode(uint32_t x, uint32_t y, uint32_t z)
+	{
+		return (ExpandBits(x) << 2) | (ExpandBits(y) << 1) | ExpandBits(z);
+	}
 }
\ No newline at end of file
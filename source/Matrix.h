@@ -1,4 +1,9 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+
+#include "MathHelpers.h"
 #include "Vector3.h"
 #include "Vector4.h"
 
@@ -6,46 +11,294 @@ namespace dae {
 	struct Matrix
 	{
 		Matrix() = default;
-		Matrix(
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
-			const Vector3& t);
+			const Vector3& t) :
+			Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+		{
+		}
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
-			const Vector4& t);
-
-		Matrix(const Matrix& m);
-
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
-		const Matrix& Transpose();
-
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
-
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
-
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+			const Vector4& t) :
+			data{ xAxis, yAxis, zAxis, t }
+		{
+		}
+
+		constexpr Matrix(const Matrix& m) = default;
+		constexpr Matrix& operator=(const Matrix& m) = default;
+
+		constexpr Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(v.x, v.y, v.z);
+		}
+
+		// row vector times the upper 3x3
+		constexpr Vector3 TransformVector(float x, float y, float z) const
+		{
+#if defined(MATH_USE_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				const __m128 result{ _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(x), data[0].Load()),
+					_mm_mul_ps(_mm_set1_ps(y), data[1].Load())),
+					_mm_mul_ps(_mm_set1_ps(z), data[2].Load())) };
+				return Vector4::Store(result);
+			}
+#endif
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z,
+				data[0].y * x + data[1].y * y + data[2].y * z,
+				data[0].z * x + data[1].z * y + data[2].z * z
+			};
+		}
+
+		constexpr Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z);
+		}
+
+		// row vector (w = 1) times the affine 3x4 part, the last column is never read
+		constexpr Vector3 TransformPoint(float x, float y, float z) const
+		{
+#if defined(MATH_USE_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				const __m128 result{ _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(x), data[0].Load()),
+					_mm_mul_ps(_mm_set1_ps(y), data[1].Load())),
+					_mm_mul_ps(_mm_set1_ps(z), data[2].Load())),
+					data[3].Load()) };
+				return Vector4::Store(result);
+			}
+#endif
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+				data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+				data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+			};
+		}
+
+		constexpr const Matrix& Transpose()
+		{
+#if defined(MATH_USE_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				__m128 row0{ data[0].Load() }, row1{ data[1].Load() }, row2{ data[2].Load() }, row3{ data[3].Load() };
+				_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+				data[0] = Vector4::Store(row0);
+				data[1] = Vector4::Store(row1);
+				data[2] = Vector4::Store(row2);
+				data[3] = Vector4::Store(row3);
+				return *this;
+			}
+#endif
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = data[c][r];
+				}
+			}
+
+			data[0] = result[0];
+			data[1] = result[1];
+			data[2] = result[2];
+			data[3] = result[3];
+
+			return *this;
+		}
+
+		constexpr const Matrix& Inverse()
+		{
+			// only handles affine matrices (last column 0,0,0,1), which is all we build
+			// p' = p * L + t  ->  p = p' * inverse(L) - t * inverse(L)
+			const Vector3 a{ data[0] };
+			const Vector3 b{ data[1] };
+			const Vector3 c{ data[2] };
+			const Vector3 t{ data[3] };
+
+			// inverse(L) = adjugate / det, the columns of the adjugate are the cross products of the rows
+			const Vector3 bc{ Vector3::Cross(b, c) };
+			const Vector3 ca{ Vector3::Cross(c, a) };
+			const Vector3 ab{ Vector3::Cross(a, b) };
+
+			const float det{ Vector3::Dot(a, bc) };
+			assert(det != 0.f);
+			const float invDet{ 1.f / det };
+
+			const Vector3 row0{ bc.x * invDet, ca.x * invDet, ab.x * invDet };
+			const Vector3 row1{ bc.y * invDet, ca.y * invDet, ab.y * invDet };
+			const Vector3 row2{ bc.z * invDet, ca.z * invDet, ab.z * invDet };
+			const Vector3 translation{ -(t.x * row0 + t.y * row1 + t.z * row2) };
+
+			data[0] = { row0, 0 };
+			data[1] = { row1, 0 };
+			data[2] = { row2, 0 };
+			data[3] = { translation, 1 };
+
+			return *this;
+		}
+
+		constexpr Vector3 GetAxisX() const
+		{
+			return data[0];
+		}
+
+		constexpr Vector3 GetAxisY() const
+		{
+			return data[1];
+		}
+
+		constexpr Vector3 GetAxisZ() const
+		{
+			return data[2];
+		}
+
+		constexpr Vector3 GetTranslation() const
+		{
+			return data[3];
+		}
+
+		static constexpr Matrix CreateTranslation(float x, float y, float z)
+		{
+			// return { {1,0,0,0},{0,1,0,0},{0,0,1,0},{x,y,z,1} };
+			// or
+			return CreateTranslation({ x,y,z });
+		}
+
+		static constexpr Matrix CreateTranslation(const Vector3& t)
+		{
+			return { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, t };
+		}
+
+		static Matrix CreateRotationX(float pitch)
+		{
+			const float sinef{ sinf(pitch) };
+			const float cosinef{ cosf(pitch) };
+			return {	{1, 0, 0},
+						{0, cosinef, -sinef},
+						{0, sinef, cosinef},
+						{0, 0, 0} };
+		}
+
+		static Matrix CreateRotationY(float yaw)
+		{
+			const float sinef{ sinf(yaw) };
+			const float cosinef{ cosf(yaw) };
+			return {	{cosinef, 0, -sinef},
+						{0, 1, 0},
+						{sinef, 0, cosinef},
+						{0, 0, 0}};
+		}
+
+		static Matrix CreateRotationZ(float roll)
+		{
+			const float sinef{ sinf(roll) };
+			const float cosinef{ cosf(roll) };
+			return {	{cosinef, sinef, 0},
+						{-sinef, cosinef, 0},
+						{0, 0, 1},
+						{0, 0, 0}};
+		}
+
+		static Matrix CreateRotation(float pitch, float yaw, float roll)
+		{
+			return CreateRotation({ pitch, yaw, roll });
+		}
+
+		static Matrix CreateRotation(const Vector3& r)
+		{
+			return CreateRotationX(r[0]) * CreateRotationY(r[1]) * CreateRotationZ(r[2]);
+		}
+
+		static constexpr Matrix CreateScale(float sx, float sy, float sz)
+		{
+			return {	{sx, 0, 0},
+						{0, sy, 0},
+						{0, 0, sz},
+						{0, 0, 0} };
+		}
+
+		static constexpr Matrix CreateScale(const Vector3& s)
+		{
+			return CreateScale(s[0], s[1], s[2]);
+		}
+
+		static constexpr Matrix Transpose(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Transpose();
+
+			return out;
+		}
+
+		static constexpr Matrix Inverse(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Inverse();
+
+			return out;
+		}
+
+		constexpr Vector4& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Vector4 operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Matrix operator*(const Matrix& m) const
+		{
+			Matrix result{};
+
+#if defined(MATH_USE_SSE)
+			if (!std::is_constant_evaluated())
+			{
+				// every row of the result is a combination of the rows of m, no transpose needed
+				const __m128 m0{ m.data[0].Load() }, m1{ m.data[1].Load() }, m2{ m.data[2].Load() }, m3{ m.data[3].Load() };
+				for (int r{ 0 }; r < 4; ++r)
+				{
+					const Vector4& row{ data[r] };
+					result.data[r] = Vector4::Store(_mm_add_ps(_mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(_mm_set1_ps(row.x), m0),
+						_mm_mul_ps(_mm_set1_ps(row.y), m1)),
+						_mm_mul_ps(_mm_set1_ps(row.z), m2)),
+						_mm_mul_ps(_mm_set1_ps(row.w), m3)));
+				}
+				return result;
+			}
+#endif
+			Matrix m_transposed = Transpose(m);
+
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
+				}
+			}
+
+			return result;
+		}
+
+		constexpr const Matrix& operator*=(const Matrix& m)
+		{
+			*this = *this * m;
+			return *this;
+		}
+
+		constexpr bool operator==(const Matrix& m) const = default;
 
 	private:
 
@@ -63,4 +316,4 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,191 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "BVHValidation.h"
+#include "DataTypes.h"
+#include "MappedFile.h"
+
+namespace dae
+{
+	namespace
+	{
+		// bump when anything about the layout below (or of Vector3 / BVHNode) changes, or the trees the builders make (2: depth capped at BVHMaxDepth)
+		constexpr uint32_t CacheVersion{ 2 };
+		constexpr char CacheMagic[4]{ 'R', 'T', 'M', 'C' };
+
+		struct CacheHeader
+		{
+			char magic[4]{};
+			uint32_t version{};
+			uint64_t sourceHash{};
+
+			// build settings the BVH was made with
+			uint32_t buildMethod{};
+			int32_t binCount{};
+			uint32_t maxLeafTriangles{};
+			uint32_t nodeSize{};
+
+			uint32_t positionCount{};
+			uint32_t normalCount{};
+			uint32_t indexCount{};
+			uint32_t nodeCount{};
+			uint32_t rootNodeIdx{};
+			float builtSAHCost{};
+		};
+
+		CacheHeader MakeHeader(uint64_t sourceHash, const TriangleMesh& mesh)
+		{
+			CacheHeader header{};
+			std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+			header.version = CacheVersion;
+			header.sourceHash = sourceHash;
+			header.buildMethod = static_cast<uint32_t>(mesh.bvhBuildMethod);
+			header.binCount = mesh.bvhBinCount;
+			header.maxLeafTriangles = mesh.bvhMaxLeafTriangles;
+			header.nodeSize = sizeof(BVHNode);
+			return header;
+		}
+	}
+
+	std::string MeshCache::GetCachePath(const std::string& sourceFilename)
+	{
+		return sourceFilename + ".meshcache";
+	}
+
+	uint64_t MeshCache::HashFile(const std::string& filename)
+	{
+		const MappedFile file{ filename };
+		if (!file.IsOpen())
+			return 0;
+
+		uint64_t hash{ 14695981039346656037ull };
+		const unsigned char* pBytes{ reinterpret_cast<const unsigned char*>(file.GetData()) };
+		for (size_t i{ 0 }; i < file.GetSize(); ++i)
+		{
+			hash = (hash ^ pBytes[i]) * 1099511628211ull;
+		}
+
+		// the size goes in as well, so files that only differ in trailing zeroes don't collide
+		return hash ^ file.GetSize();
+	}
+
+	bool MeshCache::Load(const std::string& cacheFilename, uint64_t sourceHash, TriangleMesh& mesh)
+	{
+		const MappedFile file{ cacheFilename };
+		if (!file.IsOpen() || file.GetSize() < sizeof(CacheHeader))
+			return false;
+
+		CacheHeader header{};
+		std::memcpy(&header, file.GetData(), sizeof(CacheHeader));
+
+		const CacheHeader expectedHeader{ MakeHeader(sourceHash, mesh) };
+		if (std::memcmp(header.magic, expectedHeader.magic, sizeof(header.magic)) != 0
+			|| header.version != expectedHeader.version
+			|| header.sourceHash != expectedHeader.sourceHash
+			|| header.buildMethod != expectedHeader.buildMethod
+			|| header.binCount != expectedHeader.binCount
+			|| header.maxLeafTriangles != expectedHeader.maxLeafTriangles
+			|| header.nodeSize != expectedHeader.nodeSize)
+			return false;
+
+		// a BVH needs 1 node at least and never more than the 2 * triangles the mesh allocates
+		const size_t maxNodeCount{ (header.indexCount / 3) * 2 };
+		if (header.indexCount == 0 || header.indexCount % 3 != 0 || header.nodeCount == 0 || header.nodeCount > maxNodeCount || header.rootNodeIdx >= header.nodeCount)
+			return false;
+
+		// one normal per triangle, like CalculateNormals and the parser make them
+		if (header.positionCount == 0 || header.normalCount != header.indexCount / 3)
+			return false;
+
+		const size_t expectedSize{ sizeof(CacheHeader)
+			+ header.positionCount * sizeof(Vector3)
+			+ header.normalCount * sizeof(Vector3)
+			+ header.indexCount * sizeof(int)
+			+ header.nodeCount * sizeof(BVHNode) };
+		if (file.GetSize() != expectedSize)
+			return false;
+
+		const char* pData{ file.GetData() + sizeof(CacheHeader) };
+
+		// the BVH build and the traversal index the positions with these, a broken cache gets parsed again instead
+		const char* pIndexData{ pData + (header.positionCount + header.normalCount) * sizeof(Vector3) };
+		for (uint32_t i{ 0 }; i < header.indexCount; ++i)
+		{
+			int index{};
+			std::memcpy(&index, pIndexData + i * sizeof(int), sizeof(int));
+			if (index < 0 || static_cast<uint32_t>(index) >= header.positionCount)
+				return false;
+		}
+
+		// the traversal trusts the node links as well, the tree gets checked before the mesh is touched
+		// (same allocation as BuildBVH, so a later rebuild/refit can reuse it)
+		std::vector<BVHNode> bvhNodes(maxNodeCount);
+		std::memcpy(bvhNodes.data(), pIndexData + header.indexCount * sizeof(int), header.nodeCount * sizeof(BVHNode));
+		if (!BVHValidation::AreNodesValid(bvhNodes.data(), header.nodeCount, header.indexCount))
+			return false;
+
+		mesh.positions.resize(header.positionCount);
+		std::memcpy(mesh.positions.data(), pData, header.positionCount * sizeof(Vector3));
+		pData += header.positionCount * sizeof(Vector3);
+
+		mesh.normals.resize(header.normalCount);
+		std::memcpy(mesh.normals.data(), pData, header.normalCount * sizeof(Vector3));
+		pData += header.normalCount * sizeof(Vector3);
+
+		mesh.indices.resize(header.indexCount);
+		std::memcpy(mesh.indices.data(), pData, header.indexCount * sizeof(int));
+
+		mesh.bvhNodes = std::move(bvhNodes);
+
+		mesh.bvhIndexCount = header.indexCount;
+		mesh.rootNodeIdx = header.rootNodeIdx;
+		mesh.nodesUsed = header.nodeCount - 1;
+		mesh.builtSAHCost = header.builtSAHCost;
+
+		mesh.UpdateTraversalData();
+		return true;
+	}
+
+	bool MeshCache::Save(const std::string& cacheFilename, uint64_t sourceHash, const TriangleMesh& mesh)
+	{
+		if (mesh.bvhNodes.empty() || mesh.indices.empty())
+			return false;
+
+		CacheHeader header{ MakeHeader(sourceHash, mesh) };
+		header.positionCount = static_cast<uint32_t>(mesh.positions.size());
+		header.normalCount = static_cast<uint32_t>(mesh.normals.size());
+		header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+		header.nodeCount = mesh.nodesUsed + 1;
+		header.rootNodeIdx = mesh.rootNodeIdx;
+		header.builtSAHCost = mesh.builtSAHCost;
+
+		// write next to it first, a crash halfway never leaves a broken cache behind
+		const std::string tempFilename{ cacheFilename + ".tmp" };
+		{
+			std::ofstream file{ tempFilename, std::ios::binary | std::ios::trunc };
+			if (!file)
+				return false;
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+			file.write(reinterpret_cast<const char*>(mesh.positions.data()), mesh.positions.size() * sizeof(Vector3));
+			file.write(reinterpret_cast<const char*>(mesh.normals.data()), mesh.normals.size() * sizeof(Vector3));
+			file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(int));
+			file.write(reinterpret_cast<const char*>(mesh.bvhNodes.data()), header.nodeCount * sizeof(BVHNode));
+			if (!file)
+				return false;
+		}
+
+		std::error_code error{};
+		std::filesystem::rename(tempFilename, cacheFilename, error);
+		if (error)
+		{
+			std::filesystem::remove(tempFilename, error);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+//Standard includes
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+	struct TriangleMesh;
+
+	/**
+	 * \brief Binary cache of a parsed + BVH-built mesh, stored next to the source asset.
+	 * A cache only gets used when the source file hash, the BVH build settings and the file version all match,
+	 * anything else (old cache, edited OBJ, other settings) falls back to parsing and gets overwritten.
+	 */
+	namespace MeshCache
+	{
+		// source + ".meshcache"
+		std::string GetCachePath(const std::string& sourceFilename);
+
+		// FNV-1a over the whole file, 0 if it can't be opened
+		uint64_t HashFile(const std::string& filename);
+
+		// Fills positions, normals, indices and the BVH of the mesh, uses the build settings already set on the mesh as part of the key
+		bool Load(const std::string& cacheFilename, uint64_t sourceHash, TriangleMesh& mesh);
+		bool Save(const std::string& cacheFilename, uint64_t sourceHash, const TriangleMesh& mesh);
+	}
+}
@@ -0,0 +1,243 @@
+#include "MeshFile.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "BVHValidation.h"
+#include "DataTypes.h"
+#include "MappedFile.h"
+
+namespace dae
+{
+	namespace
+	{
+		// bump when anything about the layout below (or of Vector3 / BVHNode / WideBVHNode) changes
+		constexpr uint32_t FileVersion{ 1 };
+		constexpr char FileMagic[4]{ 'R', 'T', 'M', 'F' };
+
+		// enough for the widest SIMD load, the mapping itself starts at a page boundary
+		constexpr uint64_t SectionAlignment{ 64 };
+
+		struct Section
+		{
+			uint64_t offset{};
+			uint64_t count{};
+		};
+
+		struct FileHeader
+		{
+			char magic[4]{};
+			uint32_t version{};
+
+			// the traversal sections are only usable by a build with the same node layout
+			uint32_t wideBvhWidth{};
+			uint32_t bvhNodeSize{};
+			uint32_t wideBvhNodeSize{};
+
+			uint32_t rootNodeIdx{};
+			float builtSAHCost{};
+
+			Section positions{};
+			Section indices{};
+			Section normals{};
+			Section bvhNodes{};
+			Section wideBvhNodes{};
+			Section leafTriangles{}; // count = padded triangle count, the section holds LeafTriangles::ComponentCount times that
+		};
+
+		uint64_t AlignSection(uint64_t offset)
+		{
+			return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+		}
+
+		bool IsSectionValid(const Section& section, size_t elementSize, size_t fileSize)
+		{
+			return section.offset % SectionAlignment == 0
+				&& section.offset <= fileSize
+				&& section.count <= (fileSize - section.offset) / elementSize;
+		}
+
+		// the traversal data gets rebuilt from the positions, read through the indices
+		bool AreIndicesValid(const int* pIndices, uint64_t indexCount, uint64_t positionCount)
+		{
+			for (uint64_t i{ 0 }; i < indexCount; ++i)
+			{
+				if (pIndices[i] < 0 || static_cast<uint64_t>(pIndices[i]) >= positionCount)
+					return false;
+			}
+			return true;
+		}
+
+		template<typename T>
+		const T* GetSectionData(const MappedFile& file, const Section& section)
+		{
+			return reinterpret_cast<const T*>(file.GetData() + section.offset);
+		}
+
+		template<typename T>
+		std::vector<T> CopySection(const MappedFile& file, const Section& section)
+		{
+			const T* pData{ GetSectionData<T>(file, section) };
+			return std::vector<T>(pData, pData + section.count);
+		}
+	}
+
+	bool MeshFile::Save(const std::string& filename, const TriangleMesh& mesh)
+	{
+		if (mesh.bvhNodeView.empty() || mesh.wideBvhNodeView.empty() || mesh.positions.empty())
+			return false;
+
+		FileHeader header{};
+		std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+		header.version = FileVersion;
+		header.wideBvhWidth = WideBVHWidth;
+		header.bvhNodeSize = sizeof(BVHNode);
+		header.wideBvhNodeSize = sizeof(WideBVHNode);
+		header.rootNodeIdx = mesh.rootNodeIdx;
+		header.builtSAHCost = mesh.builtSAHCost;
+
+		// lay out the sections one after the other
+		uint64_t offset{ sizeof(FileHeader) };
+		auto placeSection = [&offset](Section& section, uint64_t count, size_t elementSize)
+			{
+				section.offset = AlignSection(offset);
+				section.count = count;
+				offset = section.offset + count * elementSize;
+			};
+		placeSection(header.positions, mesh.positions.size(), sizeof(Vector3));
+		placeSection(header.indices, mesh.indices.size(), sizeof(int));
+		placeSection(header.normals, mesh.normalView.size(), sizeof(Vector3));
+		placeSection(header.bvhNodes, mesh.bvhNodeView.size(), sizeof(BVHNode));
+		placeSection(header.wideBvhNodes, mesh.wideBvhNodeView.size(), sizeof(WideBVHNode));
+		placeSection(header.leafTriangles, mesh.leafTriangles.paddedCount, sizeof(float) * LeafTriangles::ComponentCount);
+
+		// write next to it first, a crash halfway (or a process still mapping the old file) never sees a broken file
+		const std::string tempFilename{ filename + ".tmp" };
+		{
+			std::ofstream file{ tempFilename, std::ios::binary | std::ios::trunc };
+			if (!file)
+				return false;
+
+			// zero padding up to the aligned start of a section
+			auto padTo = [&file](uint64_t sectionOffset)
+				{
+					static constexpr char padding[SectionAlignment]{};
+					file.write(padding, static_cast<std::streamsize>(sectionOffset - static_cast<uint64_t>(file.tellp())));
+				};
+			auto writeSection = [&file, &padTo](const Section& section, const void* pData, size_t elementSize)
+				{
+					padTo(section.offset);
+					file.write(static_cast<const char*>(pData), static_cast<std::streamsize>(section.count * elementSize));
+				};
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+			writeSection(header.positions, mesh.positions.data(), sizeof(Vector3));
+			writeSection(header.indices, mesh.indices.data(), sizeof(int));
+			writeSection(header.normals, mesh.normalView.data(), sizeof(Vector3));
+			writeSection(header.bvhNodes, mesh.bvhNodeView.data(), sizeof(BVHNode));
+			writeSection(header.wideBvhNodes, mesh.wideBvhNodeView.data(), sizeof(WideBVHNode));
+
+			// the components are only guaranteed to be back to back when they live in storage, so write them one by one
+			const LeafTriangles& triangles{ mesh.leafTriangles };
+			padTo(header.leafTriangles.offset);
+			for (const float* pComponent : { triangles.v0X, triangles.v0Y, triangles.v0Z, triangles.edge1X, triangles.edge1Y, triangles.edge1Z,
+				triangles.edge2X, triangles.edge2Y, triangles.edge2Z, triangles.normalX, triangles.normalY, triangles.normalZ })
+			{
+				file.write(reinterpret_cast<const char*>(pComponent), static_cast<std::streamsize>(triangles.paddedCount * sizeof(float)));
+			}
+
+			if (!file)
+				return false;
+		}
+
+		std::error_code error{};
+		std::filesystem::rename(tempFilename, filename, error);
+		if (error)
+		{
+			std::filesystem::remove(tempFilename, error);
+			return false;
+		}
+		return true;
+	}
+
+	bool MeshFile::Load(const std::string& filename, TriangleMesh& mesh)
+	{
+		auto pFile{ std::make_shared<MappedFile>() };
+		if (!pFile->Open(filename) || pFile->GetSize() < sizeof(FileHeader))
+			return false;
+
+		FileHeader header{};
+		std::memcpy(&header, pFile->GetData(), sizeof(FileHeader));
+
+		const size_t fileSize{ pFile->GetSize() };
+		if (std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0
+			|| header.version != FileVersion
+			|| header.bvhNodeSize != sizeof(BVHNode)
+			|| !IsSectionValid(header.positions, sizeof(Vector3), fileSize)
+			|| !IsSectionValid(header.indices, sizeof(int), fileSize)
+			|| !IsSectionValid(header.normals, sizeof(Vector3), fileSize)
+			|| !IsSectionValid(header.bvhNodes, sizeof(BVHNode), fileSize))
+			return false;
+
+		const uint64_t triangleCount{ header.indices.count / 3 };
+		if (triangleCount == 0 || header.normals.count != triangleCount || header.bvhNodes.count == 0 || header.bvhNodes.count > triangleCount * 2
+			|| header.rootNodeIdx >= header.bvhNodes.count
+			|| !BVHValidation::AreNodesValid(GetSectionData<BVHNode>(*pFile, header.bvhNodes), header.bvhNodes.count, header.indices.count))
+			return false;
+
+		const bool hasMatchingTraversalData{ header.wideBvhWidth == WideBVHWidth
+			&& header.wideBvhNodeSize == sizeof(WideBVHNode)
+			&& header.wideBvhNodes.count > 0
+			&& header.leafTriangles.count == LeafTriangles::GetPaddedCount(triangleCount)
+			&& IsSectionValid(header.wideBvhNodes, sizeof(WideBVHNode), fileSize)
+			&& IsSectionValid(header.leafTriangles, sizeof(float) * LeafTriangles::ComponentCount, fileSize) };
+
+		// a file with a matching layout but broken links is broken, not just from another build
+		const bool isTraversalDataValid{ hasMatchingTraversalData
+			? BVHValidation::AreWideNodesValid(GetSectionData<WideBVHNode>(*pFile, header.wideBvhNodes), header.wideBvhNodes.count, header.indices.count)
+			: AreIndicesValid(GetSectionData<int>(*pFile, header.indices), header.indices.count, header.positions.count) };
+		if (!isTraversalDataValid)
+			return false;
+
+		mesh.rootNodeIdx = header.rootNodeIdx;
+		mesh.builtSAHCost = header.builtSAHCost;
+
+		if (!hasMatchingTraversalData)
+		{
+			// built by a different SIMD width: take the mesh + binary BVH and derive the rest here
+			mesh.pMappedFile.reset();
+			mesh.positions = CopySection<Vector3>(*pFile, header.positions);
+			mesh.indices = CopySection<int>(*pFile, header.indices);
+			mesh.normals = CopySection<Vector3>(*pFile, header.normals);
+
+			mesh.bvhNodes.assign(triangleCount * 2, BVHNode{});
+			std::memcpy(mesh.bvhNodes.data(), pFile->GetData() + header.bvhNodes.offset, header.bvhNodes.count * sizeof(BVHNode));
+			mesh.nodesUsed = static_cast<unsigned int>(header.bvhNodes.count - 1);
+			mesh.bvhIndexCount = static_cast<unsigned int>(header.indices.count);
+
+			mesh.UpdateTraversalData();
+			return true;
+		}
+
+		// zero copy, the mesh only keeps views into the mapping
+		mesh.positions.clear();
+		mesh.indices.clear();
+		mesh.normals.clear();
+		mesh.wideBvhNodes.clear();
+		mesh.leafTriangles.storage.clear();
+		mesh.bvhNodes.clear();
+		mesh.nodesUsed = static_cast<unsigned int>(header.bvhNodes.count - 1);
+		mesh.bvhIndexCount = static_cast<unsigned int>(header.indices.count);
+
+		mesh.bvhNodeView = { GetSectionData<BVHNode>(*pFile, header.bvhNodes), header.bvhNodes.count };
+		mesh.wideBvhNodeView = { GetSectionData<WideBVHNode>(*pFile, header.wideBvhNodes), header.wideBvhNodes.count };
+		mesh.normalView = { GetSectionData<Vector3>(*pFile, header.normals), header.normals.count };
+		mesh.leafTriangles.SetData(GetSectionData<float>(*pFile, header.leafTriangles), header.leafTriangles.count);
+		mesh.pMappedFile = std::move(pFile);
+
+		return true;
+	}
+}
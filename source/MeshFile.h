@@ -0,0 +1,25 @@
+#pragma once
+
+//Standard includes
+#include <string>
+
+namespace dae
+{
+	struct TriangleMesh;
+
+	/**
+	 * \brief Native binary mesh format (.rtmesh): a header followed by 64 byte aligned sections holding
+	 * positions, indices, normals, the binary BVH and everything the traversal reads (wide BVH + leaf triangles).
+	 * Loading maps the file and points the traversal views of the mesh straight at those sections, nothing gets parsed or copied
+	 * and every process mapping the same file shares its physical pages.
+	 * Files written by a build with a different SIMD width can still be loaded, their traversal data gets rebuilt into the mesh itself.
+	 */
+	namespace MeshFile
+	{
+		// the mesh needs a built BVH
+		bool Save(const std::string& filename, const TriangleMesh& mesh);
+
+		// replaces whatever the mesh held before, the mesh can't be updated (UpdateBVH, AppendTriangle) afterwards
+		bool Load(const std::string& filename, TriangleMesh& mesh);
+	}
+}
@@ -0,0 +1,256 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#include "MappedFile.h"
+
+namespace dae
+{
+	namespace
+	{
+		// smaller chunks aren't worth starting a thread for
+		constexpr size_t MinChunkSize{ 1 << 20 };
+
+		struct Chunk
+		{
+			const char* pBegin{};
+			const char* pEnd{};
+
+			uint32_t vertexCount{};
+			uint32_t triangleCount{};
+
+			// start of this chunk's output in the merged arrays
+			uint32_t firstVertex{};
+			uint32_t firstTriangle{};
+		};
+
+		bool IsBlank(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		const char* SkipBlanks(const char* p, const char* pEnd)
+		{
+			while (p < pEnd && IsBlank(*p))
+				++p;
+			return p;
+		}
+
+		// first char of the next line
+		const char* NextLine(const char* p, const char* pEnd)
+		{
+			while (p < pEnd && *p != '\n')
+				++p;
+			return p < pEnd ? p + 1 : pEnd;
+		}
+
+		// "v 1 2 3" and "f 1 2 3", not "vt"/"vn"
+		bool IsCommand(const char* p, const char* pEnd, char command)
+		{
+			return p + 1 < pEnd && p[0] == command && IsBlank(p[1]);
+		}
+
+		bool ParseFloat(const char*& p, const char* pEnd, float& value)
+		{
+			p = SkipBlanks(p, pEnd);
+			// from_chars doesn't take an explicit plus sign
+			if (p < pEnd && *p == '+')
+				++p;
+
+			const auto [pNext, error] { std::from_chars(p, pEnd, value) };
+			if (error != std::errc{})
+				return false;
+
+			p = pNext;
+			return true;
+		}
+
+		// reads the position index of a "v", "v/vt", "v//vn" or "v/vt/vn" token and turns it into a 0-based vertex index
+		bool ParseFaceVertex(const char*& p, const char* pEnd, uint32_t verticesRead, uint32_t totalVertexCount, int& vertexIdx)
+		{
+			int64_t index{};
+			const auto [pNext, error] { std::from_chars(p, pEnd, index) };
+			if (error != std::errc{} || index == 0)
+				return false;
+
+			// skip the texture coordinate/normal indices
+			p = pNext;
+			while (p < pEnd && !IsBlank(*p) && *p != '\n')
+				++p;
+
+			const int64_t resolvedIdx{ index > 0 ? index - 1 : static_cast<int64_t>(verticesRead) + index };
+			if (resolvedIdx < 0 || resolvedIdx >= static_cast<int64_t>(totalVertexCount))
+				return false;
+
+			vertexIdx = static_cast<int>(resolvedIdx);
+			return true;
+		}
+
+		template<typename Task>
+		void ForEachChunk(std::vector<Chunk>& chunks, const Task& task)
+		{
+			std::vector<std::thread> threads{};
+			threads.reserve(chunks.size() - 1);
+			for (size_t chunkIdx{ 0 }; chunkIdx + 1 < chunks.size(); ++chunkIdx)
+			{
+				threads.emplace_back([&task, &chunk = chunks[chunkIdx]] { task(chunk); });
+			}
+
+			// the calling thread takes the last chunk
+			task(chunks.back());
+
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		}
+
+		void CountChunk(Chunk& chunk)
+		{
+			for (const char* p{ chunk.pBegin }; p < chunk.pEnd; p = NextLine(p, chunk.pEnd))
+			{
+				if (IsCommand(p, chunk.pEnd, 'v'))
+				{
+					++chunk.vertexCount;
+				}
+				else if (IsCommand(p, chunk.pEnd, 'f'))
+				{
+					// every vertex past the first 2 adds a triangle to the fan
+					uint32_t faceVertexCount{ 0 };
+					for (p = SkipBlanks(p + 1, chunk.pEnd); p < chunk.pEnd && *p != '\n'; p = SkipBlanks(p, chunk.pEnd))
+					{
+						++faceVertexCount;
+						while (p < chunk.pEnd && !IsBlank(*p) && *p != '\n')
+							++p;
+					}
+
+					if (faceVertexCount > 2)
+						chunk.triangleCount += faceVertexCount - 2;
+				}
+			}
+		}
+
+		bool ParseChunk(const Chunk& chunk, uint32_t totalVertexCount, Vector3* pPositions, int* pIndices)
+		{
+			uint32_t verticesRead{ chunk.firstVertex };
+			int* pTriangle{ pIndices + static_cast<size_t>(chunk.firstTriangle) * 3 };
+
+			for (const char* p{ chunk.pBegin }; p < chunk.pEnd; p = NextLine(p, chunk.pEnd))
+			{
+				if (IsCommand(p, chunk.pEnd, 'v'))
+				{
+					Vector3& position{ pPositions[verticesRead++] };
+					++p;
+					if (!ParseFloat(p, chunk.pEnd, position.x) || !ParseFloat(p, chunk.pEnd, position.y) || !ParseFloat(p, chunk.pEnd, position.z))
+						return false;
+				}
+				else if (IsCommand(p, chunk.pEnd, 'f'))
+				{
+					int firstIdx{}, prevIdx{};
+					uint32_t faceVertexCount{ 0 };
+					for (p = SkipBlanks(p + 1, chunk.pEnd); p < chunk.pEnd && *p != '\n'; p = SkipBlanks(p, chunk.pEnd))
+					{
+						int vertexIdx{};
+						if (!ParseFaceVertex(p, chunk.pEnd, verticesRead, totalVertexCount, vertexIdx))
+							return false;
+
+						if (faceVertexCount == 0)
+						{
+							firstIdx = vertexIdx;
+						}
+						else if (faceVertexCount > 1)
+						{
+							pTriangle[0] = firstIdx;
+							pTriangle[1] = prevIdx;
+							pTriangle[2] = vertexIdx;
+							pTriangle += 3;
+						}
+
+						prevIdx = vertexIdx;
+						++faceVertexCount;
+					}
+				}
+			}
+
+			return true;
+		}
+	}
+
+	bool ObjParser::Parse(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, unsigned int numThreads)
+	{
+		const MappedFile file{ filename };
+		if (!file.IsOpen())
+			return false;
+
+		if (numThreads == 0)
+			numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+		// cut the file into chunks that start at the beginning of a line
+		const size_t numChunks{ std::clamp<size_t>(file.GetSize() / MinChunkSize, 1, numThreads) };
+		const char* pFileEnd{ file.GetData() + file.GetSize() };
+
+		std::vector<Chunk> chunks(numChunks);
+		const char* pChunkBegin{ file.GetData() };
+		for (size_t chunkIdx{ 0 }; chunkIdx < numChunks; ++chunkIdx)
+		{
+			const char* pSplit{ file.GetData() + file.GetSize() * (chunkIdx + 1) / numChunks };
+			const char* pChunkEnd{ chunkIdx + 1 == numChunks ? pFileEnd : NextLine(std::max(pSplit, pChunkBegin), pFileEnd) };
+
+			chunks[chunkIdx].pBegin = pChunkBegin;
+			chunks[chunkIdx].pEnd = pChunkEnd;
+			pChunkBegin = pChunkEnd;
+		}
+
+		ForEachChunk(chunks, CountChunk);
+
+		// every chunk writes its own slice of the output, so there's nothing left to merge after parsing
+		uint32_t totalVertexCount{ 0 };
+		uint32_t totalTriangleCount{ 0 };
+		for (Chunk& chunk : chunks)
+		{
+			chunk.firstVertex = totalVertexCount;
+			chunk.firstTriangle = totalTriangleCount;
+			totalVertexCount += chunk.vertexCount;
+			totalTriangleCount += chunk.triangleCount;
+		}
+
+		positions.resize(totalVertexCount);
+		indices.resize(static_cast<size_t>(totalTriangleCount) * 3);
+		normals.resize(totalTriangleCount);
+
+		std::atomic<bool> isValid{ true };
+		ForEachChunk(chunks, [&](const Chunk& chunk)
+			{
+				if (!ParseChunk(chunk, totalVertexCount, positions.data(), indices.data()))
+					isValid = false;
+			});
+
+		if (!isValid)
+		{
+			positions.clear();
+			indices.clear();
+			normals.clear();
+			return false;
+		}
+
+		// flat normals, a chunk's triangles can use vertices of any chunk so this waits until all of them are parsed
+		ForEachChunk(chunks, [&](const Chunk& chunk)
+			{
+				for (uint32_t triangleIdx{ chunk.firstTriangle }; triangleIdx < chunk.firstTriangle + chunk.triangleCount; ++triangleIdx)
+				{
+					const Vector3& v0{ positions[indices[triangleIdx * 3]] };
+					const Vector3& v1{ positions[indices[triangleIdx * 3 + 1]] };
+					const Vector3& v2{ positions[indices[triangleIdx * 3 + 2]] };
+
+					normals[triangleIdx] = Vector3::Cross(v1 - v0, v2 - v0).Normalized();
+				}
+			});
+
+		return true;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+//Standard includes
+#include <string>
+#include <vector>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	/**
+	 * \brief Wavefront OBJ loader for triangle meshes.
+	 * The file gets memory mapped and cut into line-aligned chunks that are parsed in parallel:
+	 * a first pass counts the vertices/triangles of every chunk so the output can be sized exactly,
+	 * the second pass writes every chunk straight into its own range of the merged arrays.
+	 * Faces can be written as v, v/vt, v//vn or v/vt/vn, only the position index is used.
+	 * Polygons with more than 3 vertices get fan-triangulated, negative indices are relative to the last vertex read.
+	 */
+	namespace ObjParser
+	{
+		/**
+		 * \brief Replaces the contents of positions/indices with the mesh in the file, normals gets one flat normal per triangle
+		 * \param numThreads upper bound on the amount of threads, 0 -> std::thread::hardware_concurrency()
+		 * \return false if the file can't be opened, has malformed v/f lines or faces pointing at vertices that don't exist
+		 */
+		bool Parse(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, unsigned int numThreads = 0);
+	}
+}
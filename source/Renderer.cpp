@@ -2,9 +2,7 @@
 #include "SDL.h"
 #include "SDL_surface.h"
 
-#include <thread>
-#include <future> // Async Stuff
-#include <ppl.h> // Parallel Stuff
+#include <algorithm>
 
 //Project includes
 #include "Renderer.h"
@@ -12,185 +10,328 @@
 #include "Matrix.h"
 #include "Material.h"
 #include "Scene.h"
+#include "Timer.h"
 #include "Utils.h"
 
 
 using namespace dae;
 
-//#define ASYNC
-#define PARALLEL_FOR
-
 Renderer::Renderer(SDL_Window * pWindow) :
 	m_pWindow(pWindow),
 	m_pBuffer(SDL_GetWindowSurface(pWindow))
 {
 	//Initialize
-	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
+	SDL_GetWindowSize(pWindow, &m_OutputWidth, &m_OutputHeight);
 	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
-	m_AspectRatio = m_Width / static_cast<float>(m_Height);
+	m_AspectRatio = m_OutputWidth / static_cast<float>(m_OutputHeight);
+
+	// 32 bit surface with 8 bit channels, the pixels get packed with these instead of SDL_MapRGB
+	const SDL_PixelFormat* pFormat{ m_pBuffer->format };
+	m_FrameBuffer.SetPixelLayout({ pFormat->Rshift, pFormat->Gshift, pFormat->Bshift, pFormat->Amask });
+
+	SetRenderScale(1.f);
+	m_FrameBuffer.SetSimdLevel(m_SimdLevel);
+	SelectTileKernel();
 }
 
-void Renderer::Render(Scene* pScene) const
+void Renderer::Update(const Timer* pTimer)
 {
-	Camera& camera = pScene->GetCamera();
-	camera.CalculateCameraToWorld();
+	++m_Counter;
 
-	auto& materials = pScene->GetMaterials();
-	auto& lights = pScene->GetLights();
+	if (m_TargetFrameTime <= 0.f || m_NumRenderedPixels == 0)
+		return;
 
+	// the frame time grows with the amount of pixels, a few frames get averaged so a single slow one doesn't drop the resolution
+	const float pixelCost{ pTimer->GetElapsed() / m_NumRenderedPixels };
+	m_PixelCost = (m_PixelCost > 0.f) ? m_PixelCost + (pixelCost - m_PixelCost) * 0.25f : pixelCost;
 
-	const uint32_t numPixels = m_Width * m_Height;
+	const float numOutputPixels{ static_cast<float>(m_OutputWidth) * m_OutputHeight };
+	const float idealScale{ std::clamp(std::sqrt(m_TargetFrameTime / (m_PixelCost * numOutputPixels)), MinRenderScale, 1.f) };
 
-#if defined(ASYNC)
+	// every change restarts the history, so down right away but only up once it's well within budget
+	const float steppedScale{ std::max(std::floor(idealScale * RenderScaleSteps) / RenderScaleSteps, MinRenderScale) };
+	if (steppedScale < m_DynamicScale || idealScale >= m_DynamicScale + 1.5f / RenderScaleSteps)
+		m_DynamicScale = steppedScale;
+}
 
-	// Async Logic
-	const uint32_t numCores = std::thread::hardware_concurrency();
-	std::vector<std::future<void>> async_futures{};
+void Renderer::Render(Scene* pScene)
+{
+	Camera& camera = pScene->GetCamera();
+	camera.CalculateCameraToWorld();
 
-	const uint32_t numPixelsPerTask = numPixels / numCores;
-	uint32_t numUnassignedPixels = numPixels % numCores;
-	uint32_t currPixelIndex{ 0 };
+	pScene->UpdateTopLevelBVH();
 
-	//Create Tasks
-	for (uint32_t coreId{ 0 }; coreId < numCores; ++coreId)
-	{
-		uint32_t taskSize{ numPixelsPerTask };
-		if (numUnassignedPixels > 0)
-		{
-			++taskSize;
-			--numUnassignedPixels;
-		}
+	bool hasViewChanged{ HasViewChanged(pScene, camera) };
 
-		async_futures.push_back(
-			std::async(std::launch::async, [=,this] 
-				{
-					const uint32_t pixelIndexEnd = currPixelIndex + taskSize;
-					for (uint32_t pixelIndex{ currPixelIndex }; pixelIndex < pixelIndexEnd; ++pixelIndex)
-					{
-						RenderPixel(pScene, pixelIndex, camera, lights, materials);
-					}
-				})
-		);
+	// only moving views trade resolution for time, a still view accumulates at the size of the window
+	if (SetRenderScale(hasViewChanged ? m_DynamicScale : 1.f))
+	{
+		m_IsAccumulationInvalid = true;
+		hasViewChanged = true;
+	}
 
-		currPixelIndex += taskSize;
+	// a still view keeps the buffers of the frame that got accumulated on, the reprojection needs the last frame that looked different
+	m_IsShadingCacheUsable = false;
+	if (hasViewChanged)
+	{
+		// a different setting changes what every pixel looks like, moving cameras and objects is what the reprojection handles
+		m_IsHistoryUsable = !m_IsAccumulationInvalid && pScene == m_pPreviousScene && m_FrameBuffer.GetSampleCount() > 0;
+		m_IsShadingCacheUsable = m_IsShadingCacheEnabled && m_IsHistoryUsable && pScene->GetStateVersion() == m_PreviousSceneVersion;
+
+		m_DepthBuffer.swap(m_HistoryDepthBuffer);
+		m_ShadingCache.swap(m_HistoryShadingCache);
+		m_HistoryWorldToCamera = Matrix::Inverse(m_PreviousCameraToWorld);
+		m_HistoryCameraOrigin = m_PreviousCameraToWorld.GetTranslation();
+		m_HistoryFov = m_PreviousFov;
 	}
 
-	// Wait for all tasks
-	for (const std::future<void>& f : async_futures)
+	// subsampling only pays off while the view changes, a still view gets traced in full and accumulates
+	m_IsAdaptiveFrame = m_IsAdaptiveSamplingEnabled && hasViewChanged;
+	m_IsCheckerboardFrame = m_IsCheckerboardEnabled && hasViewChanged && !m_IsAdaptiveFrame;
+	// swapped together with the depth buffer, so the color history always belongs to the same frame as the depth history
+	if (hasViewChanged)
+		m_FrameBuffer.StoreHistory();
+
+	StorePreviousView(pScene, camera);
+
+	// converged, the surface still shows the resolved average
+	if (!hasViewChanged && m_FrameBuffer.GetSampleCount() >= MaxSampleCount)
 	{
-		f.wait();
+		m_NumRenderedPixels = 0;
+		SDL_UpdateWindowSurface(m_pWindow);
+		return;
 	}
+	// only moving frames get scaled, a still view accumulates at full size and traces every pixel. Its cost would drag the
+	// average away from what a moving frame costs, where checkerboarding and adaptive subsampling skip part of the pixels.
+	m_NumRenderedPixels = hasViewChanged ? static_cast<uint32_t>(m_Width * m_Height) : 0;
+
+	// a reconstructed image isn't a good first sample to accumulate on
+	m_FrameBuffer.BeginSample(hasViewChanged || m_WasReconstructedFrame);
+	m_WasReconstructedFrame = IsReconstructedFrame();
 
+	// R2 sequence, spreads the samples evenly over the pixel no matter how many there are
+	const double sampleIndex{ static_cast<double>(m_FrameBuffer.GetSampleCount() - 1) };
+	m_SampleOffsetX = static_cast<float>(std::fmod(0.5 + sampleIndex * 0.7548776662466927, 1.0));
+	m_SampleOffsetY = static_cast<float>(std::fmod(0.5 + sampleIndex * 0.5698402909980532, 1.0));
 
-#elif defined(PARALLEL_FOR)
-	// Parallel For Logic
-	concurrency::parallel_for(0u, numPixels,
-		[=, this](int i)
+	auto& materials = pScene->GetMaterials();
+	auto& lights = pScene->GetLights();
+
+
+	// Tiles are handed to the workers as a whole, every worker writes its own block of the buffer
+	const uint32_t numTiles{ m_NumTilesX * m_NumTilesY };
+	const TileKernel pRenderTile{ m_pRenderTile };
+	const bool isScaled{ IsScaled() };
+	m_TileScheduler.Run(numTiles,
+		[&, pScene](uint32_t tileIndex)
 		{
-			RenderPixel(pScene, i, camera, lights, materials);
+			(this->*pRenderTile)(pScene, tileIndex, camera, lights, materials);
+
+			// the reconstruction, the refinement and the upscale need the neighbouring tiles, those frames resolve after them
+			if (!IsReconstructedFrame() && !isScaled)
+				ResolveTile(tileIndex);
 		});
 
-#else 
-	
-	//Synchronous Logic
-	for (uint32_t i{0}; i < numPixels; ++i)
+	if (m_IsAdaptiveFrame)
 	{
-		RenderPixel(pScene, i, camera, lights, materials);
+		const TileKernel pRefineTile{ m_pRefineTile };
+		m_TileScheduler.Run(numTiles,
+			[&, pScene](uint32_t tileIndex)
+			{
+				(this->*pRefineTile)(pScene, tileIndex, camera, lights, materials);
+				if (!isScaled)
+					ResolveTile(tileIndex);
+			});
 	}
 
-#endif
-
-
+	if (m_IsCheckerboardFrame)
+	{
+		m_TileScheduler.Run(numTiles,
+			[&](uint32_t tileIndex)
+			{
+				ReconstructTile(tileIndex, camera);
+				if (!isScaled)
+					ResolveTile(tileIndex);
+			});
+	}
 
+	if (isScaled)
+	{
+		const uint32_t numBands{ (static_cast<uint32_t>(m_OutputHeight) + m_TileSize - 1) / m_TileSize };
+		m_TileScheduler.Run(numBands,
+			[&](uint32_t bandIndex)
+			{
+				ResolveScaledBand(bandIndex);
+			});
+	}
 
 	//@END
 	//Update SDL Surface
 	SDL_UpdateWindowSurface(m_pWindow);
 }
 
-void dae::Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material*>& materials) const
+const Renderer::ShadingCacheEntry* dae::Renderer::FindCachedShading(const HitRecord& closestHit, int px, int py) const
 {
-	const int py = pixelIndex / m_Width;
-	if (py % 2 != m_Counter % 2)
-		return;
-
-	const int px = pixelIndex % m_Width;
-
-	const float cx{ ((2.f * (px + 0.5f)) / m_Width - 1) * m_AspectRatio * camera.fov };
-	const float cy{ (1.f - ((2.f * (py + 0.5f)) / m_Height)) * camera.fov };
-
-	Vector3 rayDirection{ cx, cy , 1 };
-	rayDirection = camera.cameraToWorld.TransformVector(rayDirection).Normalized();
-
-	Ray viewRay{ camera.origin, rayDirection, {1.0f / rayDirection.x, 1.0f / rayDirection.y, 1.0f / rayDirection.z} };
-
-	ColorRGB finalColor{};
-
-	HitRecord closestHit{};
-	pScene->GetClosestHit(viewRay, closestHit);
+	// a slice of the screen gets shaded again every frame, so a camera that keeps moving doesn't make all of them expire together
+	if ((px + py * 3 + m_Counter) % MaxShadingAge == 0)
+		return nullptr;
+
+	// the pixel the hit point was in last frame
+	const Vector3 historyPosition{ m_HistoryWorldToCamera.TransformPoint(closestHit.origin) };
+	if (historyPosition.z <= 0.f)
+		return nullptr;
+
+	const int historyX{ static_cast<int>(std::floor(((historyPosition.x / historyPosition.z) / (m_AspectRatio * m_HistoryFov) + 1.f) * 0.5f * m_Width)) };
+	const int historyY{ static_cast<int>(std::floor((1.f - (historyPosition.y / historyPosition.z) / m_HistoryFov) * 0.5f * m_Height)) };
+	if (historyX < 0 || historyX >= m_Width || historyY < 0 || historyY >= m_Height)
+		return nullptr;
+
+	// something else in front of it (disocclusion), or shaded too long ago
+	const ShadingCacheEntry& entry{ m_HistoryShadingCache[historyX + historyY * m_Width] };
+	if (entry.age >= MaxShadingAge || entry.objectId != closestHit.objectId || entry.primitiveIndex != closestHit.primitiveIndex)
+		return nullptr;
+
+	// planes and big triangles cover many pixels, the shading (shadow edges) is only close enough within about a pixel
+	const float pixelSize{ 2.f * m_HistoryFov * historyPosition.z / m_Height };
+	if ((entry.position - closestHit.origin).SqrMagnitude() > pixelSize * pixelSize)
+		return nullptr;
+
+	return &entry;
+}
 
+void dae::Renderer::ReconstructTile(uint32_t tileIndex, const Camera& camera) const
+{
+	const auto [startX, startY, endX, endY] { GetTileRect(tileIndex) };
+	const uint32_t width{ static_cast<uint32_t>(m_Width) };
+	const uint32_t height{ static_cast<uint32_t>(m_Height) };
 
-	if (closestHit.didHit)
+	for (uint32_t py{ startY }; py < endY; ++py)
 	{
-		const Vector3 originOffset{ closestHit.origin + closestHit.normal * 0.0001f }; // Use small offset for the ray origin (self-shadowing)
-		//for (size_t i{ 0 }; i < lights.size(); ++i)
-		for (const Light& currLight: lights)
+		// the pixels the checkerboard skipped, their 4 direct neighbours all got traced
+		for (uint32_t px{ IsTracedPixel(startX, py) ? startX + 1 : startX }; px < endX; px += 2)
 		{
-			Vector3 lightDirection{ LightUtils::GetDirectionToLight(currLight, originOffset) };
-			const float lightDistance{ lightDirection.Normalize() }; // normalizing the vector returns the distance
-
-			if (m_ShadowsEnabled)
-			{
-				Ray invLightRay{ originOffset, lightDirection, {1.0f / lightDirection.x, 1.0f / lightDirection.y, 1.0f / lightDirection.z} , 0.0f, lightDistance }; // W2 slide 25
+			const uint32_t pixelIndex{ px + py * width };
 
-				if (pScene->DoesHit(invLightRay))
-					continue;
+			// the image border mirrors to the neighbour on the other side
+			const uint32_t left{ px > 0 ? pixelIndex - 1 : pixelIndex + 1 };
+			const uint32_t right{ px + 1 < width ? pixelIndex + 1 : pixelIndex - 1 };
+			const uint32_t up{ py > 0 ? pixelIndex - width : pixelIndex + width };
+			const uint32_t down{ py + 1 < height ? pixelIndex + width : pixelIndex - width };
 
-			}
+			// interpolate along the edge, the pair whose depths agree the most lies on the same surface
+			const bool isHorizontal{ std::abs(m_DepthBuffer[left] - m_DepthBuffer[right]) <= std::abs(m_DepthBuffer[up] - m_DepthBuffer[down]) };
+			const uint32_t first{ isHorizontal ? left : up };
+			const uint32_t second{ isHorizontal ? right : down };
 
-			switch (m_CurrentLightingMode)
-			{
-			case dae::Renderer::LightingMode::ObservedArea:
-			{
+			const ColorRGB firstColor{ m_FrameBuffer.GetPixel(first) };
+			const ColorRGB secondColor{ m_FrameBuffer.GetPixel(second) };
+			ColorRGB color{ (firstColor + secondColor) * 0.5f };
 
-				const float normalLightAngle{ std::max(Vector3::Dot(closestHit.normal, lightDirection), 0.0f )}; // angle between normal and light direction (cosine theta)
+			// on a silhouette (one of them missed) the pixel gets the depth of the hit
+			const float firstDepth{ m_DepthBuffer[first] };
+			const float secondDepth{ m_DepthBuffer[second] };
+			const float depth{ (firstDepth == FLT_MAX || secondDepth == FLT_MAX) ? std::min(firstDepth, secondDepth) : (firstDepth + secondDepth) * 0.5f };
 
-				// only multiply if normalLightAngle is bigger then 0, replacement of if statement
-				finalColor += ColorRGB{ normalLightAngle, normalLightAngle, normalLightAngle };
-			}
-				break;
-			case dae::Renderer::LightingMode::Radiance:
-				finalColor += LightUtils::GetRadiance(currLight, closestHit.origin);
-				break;
-			case dae::Renderer::LightingMode::BRDF:
-				finalColor += materials[closestHit.materialIndex]->Shade(closestHit, lightDirection, rayDirection);
-				break;
-			case dae::Renderer::LightingMode::Combined:
+			if (m_IsHistoryUsable && depth != FLT_MAX)
 			{
-				const float normalLightAngle{ std::max(Vector3::Dot(closestHit.normal, lightDirection), 0.0f )}; // angle between normal and light direction (cosine theta)
-
-				// formula getting too long, making variables...
+				// where this pixel's surface point was on screen last frame
+				const float cx{ ((2.f * (px + 0.5f)) / m_Width - 1) * m_AspectRatio * camera.fov };
+				const float cy{ (1.f - ((2.f * (py + 0.5f)) / m_Height)) * camera.fov };
+				const Vector3 worldPosition{ camera.origin + camera.cameraToWorld.TransformVector(cx, cy, 1.f).Normalized() * depth };
+				const Vector3 historyPosition{ m_HistoryWorldToCamera.TransformPoint(worldPosition) };
 
-				const ColorRGB radiance{ LightUtils::GetRadiance(currLight, closestHit.origin) };
-				const ColorRGB brdf{ materials[closestHit.materialIndex]->Shade(closestHit, lightDirection, rayDirection) };
+				if (historyPosition.z > 0.f)
+				{
+					// bilinear between the 4 history pixels around it, the centers sit at +0.5
+					const float historyX{ ((historyPosition.x / historyPosition.z) / (m_AspectRatio * m_HistoryFov) + 1.f) * 0.5f * m_Width - 0.5f };
+					const float historyY{ (1.f - (historyPosition.y / historyPosition.z) / m_HistoryFov) * 0.5f * m_Height - 0.5f };
+					const int x0{ static_cast<int>(std::floor(historyX)) };
+					const int y0{ static_cast<int>(std::floor(historyY)) };
 
-				finalColor += radiance * brdf * normalLightAngle;
-			}
-				break;
+					if (x0 >= 0 && x0 + 1 < m_Width && y0 >= 0 && y0 + 1 < m_Height)
+					{
+						const float fx{ historyX - x0 };
+						const float fy{ historyY - y0 };
+						const uint32_t historyIndex{ static_cast<uint32_t>(x0 + y0 * m_Width) };
+						const uint32_t taps[4]{ historyIndex, historyIndex + 1, historyIndex + width, historyIndex + width + 1 };
+						const float weights[4]{ (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy };
+
+						// something else covered the point last frame (disocclusion) -> keep the interpolated color,
+						// tight since a spinning object keeps its depth while its shading moves
+						const float expectedDepth{ (worldPosition - m_HistoryCameraOrigin).Magnitude() };
+						bool isValid{ true };
+						ColorRGB history{};
+						for (int i{ 0 }; i < 4; ++i)
+						{
+							isValid &= std::abs(m_HistoryDepthBuffer[taps[i]] - expectedDepth) <= 0.005f * expectedDepth;
+							history += m_FrameBuffer.GetHistoryPixel(taps[i]) * weights[i];
+						}
+
+						if (isValid)
+						{
+							// clamped to the neighbourhood of this frame, so moving objects and lights don't leave trails
+							const ColorRGB upColor{ m_FrameBuffer.GetPixel(up) };
+							const ColorRGB downColor{ m_FrameBuffer.GetPixel(down) };
+							const ColorRGB leftColor{ m_FrameBuffer.GetPixel(left) };
+							const ColorRGB rightColor{ m_FrameBuffer.GetPixel(right) };
+							const auto clampChannel = [](float value, float a, float b, float c, float d)
+								{
+									return std::clamp(value, std::min(std::min(a, b), std::min(c, d)), std::max(std::max(a, b), std::max(c, d)));
+								};
+
+							color.r = clampChannel(history.r, leftColor.r, rightColor.r, upColor.r, downColor.r);
+							color.g = clampChannel(history.g, leftColor.g, rightColor.g, upColor.g, downColor.g);
+							color.b = clampChannel(history.b, leftColor.b, rightColor.b, upColor.b, downColor.b);
+						}
+					}
+				}
 			}
 
+			m_FrameBuffer.AddSample(pixelIndex, color);
+			m_DepthBuffer[pixelIndex] = depth;
+			m_ShadingCache[pixelIndex].age = InvalidShadingAge;
 		}
 	}
+}
 
+bool dae::Renderer::IsUniformBlock(const uint32_t (&pixelIndices)[4]) const
+{
+	// every object has a single material, the same object and triangle is the same material as well
+	const bool isMiss{ m_DepthBuffer[pixelIndices[0]] == FLT_MAX };
+	const ShadingCacheEntry& first{ m_ShadingCache[pixelIndices[0]] };
+	ColorRGB minColor{ m_FrameBuffer.GetPixel(pixelIndices[0]) };
+	ColorRGB maxColor{ minColor };
+
+	for (int i{ 1 }; i < 4; ++i)
+	{
+		if ((m_DepthBuffer[pixelIndices[i]] == FLT_MAX) != isMiss)
+			return false;
+
+		const ShadingCacheEntry& entry{ m_ShadingCache[pixelIndices[i]] };
+		if (!isMiss && (entry.objectId != first.objectId || entry.primitiveIndex != first.primitiveIndex))
+			return false;
 
+		const ColorRGB color{ m_FrameBuffer.GetPixel(pixelIndices[i]) };
+		minColor = { std::min(minColor.r, color.r), std::min(minColor.g, color.g), std::min(minColor.b, color.b) };
+		maxColor = { std::max(maxColor.r, color.r), std::max(maxColor.g, color.g), std::max(maxColor.b, color.b) };
+	}
 
-	//Update Color in Buffer
-	finalColor.MaxToOne();
+	// a shadow edge or highlight between the corners, relative so bright surfaces don't get refined for noise-sized differences
+	const auto isClose = [](float minValue, float maxValue) { return maxValue - minValue <= 0.02f + 0.05f * maxValue; };
+	return isClose(minColor.r, maxColor.r) && isClose(minColor.g, maxColor.g) && isClose(minColor.b, maxColor.b);
+}
 
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
+void dae::Renderer::ResolveTile(uint32_t tileIndex) const
+{
+	const TileRect tile{ GetTileRect(tileIndex) };
+	m_FrameBuffer.Resolve(m_pBufferPixels, tile.startX, tile.endX, tile.startY, tile.endY);
+}
+
+void dae::Renderer::ResolveScaledBand(uint32_t bandIndex) const
+{
+	const uint32_t startY{ bandIndex * m_TileSize };
+	const uint32_t endY{ std::min(startY + m_TileSize, static_cast<uint32_t>(m_OutputHeight)) };
+	m_FrameBuffer.ResolveScaled(m_pBufferPixels, m_OutputWidth, m_OutputHeight, startY, endY);
 }
 
 bool Renderer::SaveBufferToImage() const
@@ -201,4 +342,146 @@ bool Renderer::SaveBufferToImage() const
 void dae::Renderer::CycleLightingMode()
 {
 	m_CurrentLightingMode = LightingMode((static_cast<int>(m_CurrentLightingMode) + 1) % 4 ); // add one to current value, if it is 4, will reset to 0
+	SelectTileKernel();
+	m_IsAccumulationInvalid = true;
+}
+
+void dae::Renderer::ToggleShadows()
+{
+	m_ShadowsEnabled = !m_ShadowsEnabled;
+	SelectTileKernel();
+	m_IsAccumulationInvalid = true;
+}
+
+// the display settings invalidate the history as well, a converged image doesn't get resolved again otherwise
+void dae::Renderer::CycleToneMapping()
+{
+	m_FrameBuffer.SetToneMapping(ToneMapping((static_cast<int>(m_FrameBuffer.GetToneMapping()) + 1) % 3));
+	m_IsAccumulationInvalid = true;
+}
+
+void dae::Renderer::ToggleSRGB()
+{
+	m_FrameBuffer.SetSRGBEnabled(!m_FrameBuffer.IsSRGBEnabled());
+	m_IsAccumulationInvalid = true;
+}
+
+void dae::Renderer::ToggleAccumulation()
+{
+	m_IsAccumulating = !m_IsAccumulating;
+	m_IsAccumulationInvalid = true;
+}
+
+// the history of a converged view belongs to an older frame than the depth and shading cache, none of it gets reused after these
+void dae::Renderer::ToggleCheckerboard()
+{
+	m_IsCheckerboardEnabled = !m_IsCheckerboardEnabled;
+	m_IsAccumulationInvalid = true;
+}
+
+void dae::Renderer::ToggleShadingCache()
+{
+	m_IsShadingCacheEnabled = !m_IsShadingCacheEnabled;
+	m_IsAccumulationInvalid = true;
+}
+
+void dae::Renderer::ToggleAdaptiveSampling()
+{
+	m_IsAdaptiveSamplingEnabled = !m_IsAdaptiveSamplingEnabled;
+	m_IsAccumulationInvalid = true;
+}
+
+void dae::Renderer::SetTargetFrameTime(float seconds)
+{
+	m_TargetFrameTime = std::max(seconds, 0.f);
+	m_PixelCost = 0.f;
+	m_DynamicScale = 1.f;
+}
+
+bool dae::Renderer::SetRenderScale(float scale)
+{
+	const int width{ std::max(static_cast<int>(std::lround(m_OutputWidth * scale)), 1) };
+	const int height{ std::max(static_cast<int>(std::lround(m_OutputHeight * scale)), 1) };
+	if (width == m_Width && height == m_Height)
+		return false;
+
+	// the aspect ratio stays the one of the window, the rounding only makes the pixels a bit wider or taller
+	m_Width = width;
+	m_Height = height;
+
+	m_FrameBuffer.Resize(m_Width, m_Height);
+	m_DepthBuffer.assign(static_cast<size_t>(m_Width) * m_Height, FLT_MAX);
+	m_HistoryDepthBuffer.assign(m_DepthBuffer.size(), FLT_MAX);
+	m_ShadingCache.assign(m_DepthBuffer.size(), ShadingCacheEntry{ {}, {}, 0, 0, InvalidShadingAge });
+	m_HistoryShadingCache.assign(m_DepthBuffer.size(), ShadingCacheEntry{ {}, {}, 0, 0, InvalidShadingAge });
+
+	SetTileSize(m_TileSize);
+	return true;
+}
+
+bool dae::Renderer::HasViewChanged(const Scene* pScene, const Camera& camera) const
+{
+	return !m_IsAccumulating || m_IsAccumulationInvalid
+		|| pScene != m_pPreviousScene || pScene->GetStateVersion() != m_PreviousSceneVersion
+		|| camera.cameraToWorld != m_PreviousCameraToWorld || camera.fov != m_PreviousFov;
+}
+
+void dae::Renderer::StorePreviousView(const Scene* pScene, const Camera& camera)
+{
+	m_IsAccumulationInvalid = false;
+	m_pPreviousScene = pScene;
+	m_PreviousSceneVersion = pScene->GetStateVersion();
+	m_PreviousCameraToWorld = camera.cameraToWorld;
+	m_PreviousFov = camera.fov;
+}
+
+Renderer::TileRect dae::Renderer::GetTileRect(uint32_t tileIndex) const
+{
+	const uint32_t tileX{ tileIndex % m_NumTilesX };
+	const uint32_t tileY{ tileIndex / m_NumTilesX };
+
+	const uint32_t startX{ tileX * m_TileSize };
+	const uint32_t startY{ tileY * m_TileSize };
+	// edge tiles can be cut off by the window
+	const uint32_t endX{ std::min(startX + m_TileSize, static_cast<uint32_t>(m_Width)) };
+	const uint32_t endY{ std::min(startY + m_TileSize, static_cast<uint32_t>(m_Height)) };
+
+	return { startX, startY, endX, endY };
+}
+
+void dae::Renderer::SetSimdLevel(SimdLevel level)
+{
+	m_SimdLevel = CpuFeatures::GetUsableSimdLevel(level);
+	m_FrameBuffer.SetSimdLevel(m_SimdLevel);
+	SelectTileKernel();
+}
+
+void dae::Renderer::SelectTileKernel()
+{
+	const TileKernels* pKernels{};
+	switch (m_SimdLevel)
+	{
+	case SimdLevel::AVX512:
+		pKernels = &GetTileKernels<SimdLevel::AVX512>();
+		break;
+	case SimdLevel::AVX2:
+		pKernels = &GetTileKernels<SimdLevel::AVX2>();
+		break;
+	case SimdLevel::SSE4:
+		pKernels = &GetTileKernels<SimdLevel::SSE4>();
+		break;
+	default:
+		pKernels = &GetTileKernels<SimdLevel::SSE2>();
+		break;
+	}
+
+	m_pRenderTile = pKernels->renderTile[static_cast<int>(m_CurrentLightingMode)][m_ShadowsEnabled];
+	m_pRefineTile = pKernels->refineTile[static_cast<int>(m_CurrentLightingMode)][m_ShadowsEnabled];
+}
+
+void dae::Renderer::SetTileSize(uint32_t tileSize)
+{
+	m_TileSize = std::max(tileSize, 1u);
+	m_NumTilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+	m_NumTilesY = (m_Height + m_TileSize - 1) / m_TileSize;
 }
\ No newline at end of file
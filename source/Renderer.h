@@ -3,6 +3,11 @@
 #include <cstdint>
 #include <vector>
 
+#include "CpuFeatures.h"
+#include "FrameBuffer.h"
+#include "Matrix.h"
+#include "TileScheduler.h"
+
 struct SDL_Window;
 struct SDL_Surface;
 
@@ -10,9 +15,15 @@ struct SDL_Surface;
 namespace dae
 {
 	class Scene;
+	class Timer;
 	struct Camera;
 	struct Light;
-	class Material;
+	struct HitRecord;
+	struct Vector3;
+	struct Material;
+	enum class MaterialType : uint8_t;
+	template<int N> struct RayPacket;
+	template<int N> struct PacketHitRecord;
 
 	class Renderer final
 	{
@@ -25,17 +36,48 @@ namespace dae
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Update() { ++m_Counter; }
-
-		void Render(Scene* pScene) const;
+		// picks the render resolution for the next frame from the previous frame's time
+		void Update(const Timer* pTimer);
 
-		void RenderPixel(Scene* pScene, uint32_t pixelIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material*>& materials) const;
+		void Render(Scene* pScene);
 
 		bool SaveBufferToImage() const;
 
 
 		void CycleLightingMode();
-		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; }
+		void ToggleShadows();
+		void CycleToneMapping();
+		void ToggleSRGB();
+		// on -> while the camera and scene stand still every frame adds a jittered sample to every pixel and the average is shown
+		// off -> every frame starts over with a sample in the pixel centers
+		void ToggleAccumulation();
+		// on -> frames in which the view changed only trace half the pixels in a checkerboard pattern that flips every frame,
+		// the others get reconstructed from their neighbours and the reprojected previous frame
+		void ToggleCheckerboard();
+		// on -> while only the camera moves, pixels that hit the same spot of the same primitive as last frame reuse its shading
+		// instead of tracing shadow rays and evaluating the BRDF again
+		void ToggleShadingCache();
+		// on -> frames in which the view changed first trace every AdaptiveBlockSize-th pixel, blocks whose corners hit the same
+		// primitive with about the same color get interpolated and only the others are traced in full, takes precedence over checkerboarding
+		void ToggleAdaptiveSampling();
+		uint32_t GetSampleCount() const { return m_FrameBuffer.GetSampleCount(); }
+
+		// > 0 -> frames in which the view changes render at a lower resolution when needed to stay within this time and get scaled up
+		// to the window, 0 -> always at the window size
+		void SetTargetFrameTime(float seconds);
+		float GetTargetFrameTime() const { return m_TargetFrameTime; }
+		int GetRenderWidth() const { return m_Width; }
+		int GetRenderHeight() const { return m_Height; }
+
+		// 0 -> one worker per hardware thread
+		void SetWorkerCount(uint32_t numWorkers) { m_TileScheduler.SetWorkerCount(numWorkers); }
+		uint32_t GetWorkerCount() const { return m_TileScheduler.GetWorkerCount(); }
+		void SetTileSize(uint32_t tileSize);
+		uint32_t GetTileSize() const { return m_TileSize; }
+
+		// packet kernels to use, clamped to what the CPU supports and the build contains
+		void SetSimdLevel(SimdLevel level);
+		SimdLevel GetSimdLevel() const { return m_SimdLevel; }
 	private:
 
 		enum class LightingMode
@@ -46,19 +88,168 @@ namespace dae
 			Combined = 3 // ObservedArea * Radiance * BRDF -> default
 		};
 
+		// The kernels below are compiled once for every lighting mode and shadow setting, so the per light loop doesn't branch on them,
+		// and once for every instruction set (Kernels_*.cpp). The matching RenderTile gets picked whenever one of the settings changes.
+		using TileKernel = void (Renderer::*)(Scene* pScene, uint32_t tileIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+		struct TileKernels
+		{
+			// [LightingMode][Shadows]
+			TileKernel renderTile[4][2];
+			TileKernel refineTile[4][2];
+		};
+		template<SimdLevel Level>
+		static const TileKernels& GetTileKernels();
+
+		template<SimdLevel Level, LightingMode Mode, bool Shadows>
+		void RenderTile(Scene* pScene, uint32_t tileIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+		// traces the pixels of the adaptive blocks in this tile whose corners differ, interpolates the others
+		template<SimdLevel Level, LightingMode Mode, bool Shadows>
+		void RefineTile(Scene* pScene, uint32_t tileIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+		template<SimdLevel Level, LightingMode Mode, bool Shadows>
+		void RenderPixel(Scene* pScene, uint32_t pixelIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+		// traces N pixels of one row, pixelStep apart, as a single ray packet
+		template<SimdLevel Level, int N, LightingMode Mode, bool Shadows>
+		void RenderPacket(Scene* pScene, uint32_t startX, uint32_t pixelStep, uint32_t py, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+		// as many full packets of N pixels as fit in [startX, endX), returns where the remainder starts
+		template<SimdLevel Level, int N, LightingMode Mode, bool Shadows>
+		uint32_t RenderPackets(Scene* pScene, uint32_t startX, uint32_t endX, uint32_t pixelStep, uint32_t py, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+		// shades the lanes in laneMask, which all hit a material of this Type (or missed, with SolidColor)
+		template<SimdLevel Level, MaterialType Type, int N, LightingMode Mode, bool Shadows>
+		void ShadeLanes(Scene* pScene, int laneMask, uint32_t startX, uint32_t pixelStep, uint32_t py, const PacketHitRecord<N>& closestHit, const RayPacket<N>& viewRay, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+		// switches on the material of the hit once, the light loop of ShadePixel<Type> then calls the BRDF of that type directly
+		template<SimdLevel Level, LightingMode Mode, bool Shadows>
+		void ShadePixel(Scene* pScene, int px, int py, const HitRecord& closestHit, const Vector3& rayDirection, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+		template<SimdLevel Level, MaterialType Type, LightingMode Mode, bool Shadows>
+		void ShadePixel(Scene* pScene, int px, int py, const HitRecord& closestHit, const Vector3& rayDirection, const std::vector<Light>& lights, const std::vector<Material>& materials) const;
+
+		struct TileRect
+		{
+			uint32_t startX;
+			uint32_t startY;
+			uint32_t endX;
+			uint32_t endY;
+		};
+		TileRect GetTileRect(uint32_t tileIndex) const;
+
+		// fills in the pixels a checkerboard frame didn't trace
+		void ReconstructTile(uint32_t tileIndex, const Camera& camera) const;
+		void ResolveTile(uint32_t tileIndex) const;
+		// scaled frames get resolved in bands of output rows, once every rendered pixel is done
+		void ResolveScaledBand(uint32_t bandIndex) const;
+		bool IsScaled() const { return m_Width != m_OutputWidth || m_Height != m_OutputHeight; }
+		bool IsTracedPixel(uint32_t px, uint32_t py) const { return !m_IsCheckerboardFrame || (px + py + m_Counter) % 2 == 0; }
+		// the corners of the adaptive blocks, the last row and column close the blocks at the border
+		bool IsGridColumn(uint32_t px) const { return px % AdaptiveBlockSize == 0 || px == static_cast<uint32_t>(m_Width) - 1; }
+		bool IsGridRow(uint32_t py) const { return py % AdaptiveBlockSize == 0 || py == static_cast<uint32_t>(m_Height) - 1; }
+		// the corner pixels hit the same surface and got about the same color, pixelIndices: top left, top right, bottom left, bottom right
+		bool IsUniformBlock(const uint32_t (&pixelIndices)[4]) const;
+		// only part of the pixels got traced, the image isn't a good first sample to accumulate on
+		bool IsReconstructedFrame() const { return m_IsCheckerboardFrame || m_IsAdaptiveFrame; }
+
+		// the camera, the scene or a setting changed since the previous frame, the accumulated samples are useless
+		bool HasViewChanged(const Scene* pScene, const Camera& camera) const;
+		void StorePreviousView(const Scene* pScene, const Camera& camera);
+
+		void SelectTileKernel();
+
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
 		bool m_ShadowsEnabled{ true };
+		TileKernel m_pRenderTile{};
+		TileKernel m_pRefineTile{};
 
 		SDL_Window* m_pWindow{};
 
 		SDL_Surface* m_pBuffer{};
 		uint32_t* m_pBufferPixels{};
-
+		// HDR colors the kernels shade into, resolved into m_pBufferPixels tile by tile
+		// mutable since the const kernels write it, every worker only touches the pixels of its own tile
+		mutable FrameBuffer m_FrameBuffer{};
+
+		// size of the window
+		int m_OutputWidth{};
+		int m_OutputHeight{};
+		// size the frame gets rendered at, everything but the final resolve works in these
 		int m_Width{};
 		int m_Height{};
 
 		float m_AspectRatio{};
 
+		// dynamic resolution, the render size is the window size times the scale, in steps of 1 / RenderScaleSteps
+		static constexpr float MinRenderScale{ 0.25f };
+		static constexpr float RenderScaleSteps{ 16.f };
+		float m_TargetFrameTime{};
+		float m_DynamicScale{ 1.f };
+		// seconds per rendered pixel, averaged over the last frames in which the view changed
+		float m_PixelCost{};
+		// what the previous frame rendered, 0 -> the view stood still, the frame doesn't count for the average
+		uint32_t m_NumRenderedPixels{};
+
+		// resizes every per pixel buffer when the render size changes, returns whether it did
+		bool SetRenderScale(float scale);
+
+		TileScheduler m_TileScheduler{};
+		uint32_t m_TileSize{ 32 };
+		uint32_t m_NumTilesX{};
+		uint32_t m_NumTilesY{};
+
 		unsigned int m_Counter{};
+
+		// progressive accumulation, after MaxSampleCount samples the image is converged and nothing gets traced anymore
+		static constexpr uint32_t MaxSampleCount{ 1024 };
+		bool m_IsAccumulating{ true };
+		bool m_IsAccumulationInvalid{ true };
+		// sub pixel position of this frame's samples, the first one sits in the center
+		float m_SampleOffsetX{ 0.5f };
+		float m_SampleOffsetY{ 0.5f };
+
+		const Scene* m_pPreviousScene{};
+		uint32_t m_PreviousSceneVersion{};
+		Matrix m_PreviousCameraToWorld{};
+		float m_PreviousFov{};
+
+		// checkerboard rendering
+		bool m_IsCheckerboardEnabled{ true };
+		bool m_IsCheckerboardFrame{ false };
+		bool m_WasReconstructedFrame{ false };
+		// the previous frame can be reprojected (same scene and settings)
+		bool m_IsHistoryUsable{ false };
+		// previous frame's camera, to find where a point was on screen
+		Matrix m_HistoryWorldToCamera{};
+		Vector3 m_HistoryCameraOrigin{};
+		float m_HistoryFov{};
+
+		// distance to the primary hit per pixel (FLT_MAX -> miss), written by the kernels, estimated for reconstructed pixels
+		mutable std::vector<float> m_DepthBuffer{};
+		std::vector<float> m_HistoryDepthBuffer{};
+
+		// shading cache, what every pixel hit and the color that got shaded for it
+		struct ShadingCacheEntry
+		{
+			Vector3 position;
+			ColorRGB color;
+			uint32_t objectId;
+			uint32_t primitiveIndex;
+			// frames since the color was shaded, InvalidShadingAge -> nothing to reuse (miss or reconstructed pixel)
+			uint32_t age;
+		};
+		static constexpr uint32_t InvalidShadingAge{ UINT32_MAX };
+		// a reused color belongs to a point up to a pixel away, every pixel gets shaded again at least this often
+		static constexpr uint32_t MaxShadingAge{ 8 };
+		bool m_IsShadingCacheEnabled{ true };
+		// only the camera moved since the previous frame, the lights, the objects and their shadows are still the same
+		bool m_IsShadingCacheUsable{ false };
+		mutable std::vector<ShadingCacheEntry> m_ShadingCache{};
+		std::vector<ShadingCacheEntry> m_HistoryShadingCache{};
+
+		// adaptive sampling
+		static constexpr uint32_t AdaptiveBlockSize{ 4 };
+		bool m_IsAdaptiveSamplingEnabled{ false };
+		bool m_IsAdaptiveFrame{ false };
+
+		// the shading the previous frame computed for this hit, nullptr -> it has to be shaded
+		const ShadingCacheEntry* FindCachedShading(const HitRecord& closestHit, int px, int py) const;
+
+		// picked once from CPUID, the widest packets this machine can run
+		SimdLevel m_SimdLevel{ CpuFeatures::GetUsableSimdLevel() };
 	};
 }
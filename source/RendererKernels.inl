@@ -0,0 +1,327 @@
+// Render kernels of the Renderer, only included by the Kernels_*.cpp files (see Kernels.inl).
+#include "Renderer.h"
+#include "Material.h"
+#include "Scene.h"
+#include "Utils.h"
+
+namespace dae
+{
+	template<SimdLevel Level>
+	const Renderer::TileKernels& Renderer::GetTileKernels()
+	{
+		static const TileKernels kernels{
+			{
+				{ &Renderer::RenderTile<Level, LightingMode::ObservedArea, false>, &Renderer::RenderTile<Level, LightingMode::ObservedArea, true> },
+				{ &Renderer::RenderTile<Level, LightingMode::Radiance, false>, &Renderer::RenderTile<Level, LightingMode::Radiance, true> },
+				{ &Renderer::RenderTile<Level, LightingMode::BRDF, false>, &Renderer::RenderTile<Level, LightingMode::BRDF, true> },
+				{ &Renderer::RenderTile<Level, LightingMode::Combined, false>, &Renderer::RenderTile<Level, LightingMode::Combined, true> }
+			},
+			{
+				{ &Renderer::RefineTile<Level, LightingMode::ObservedArea, false>, &Renderer::RefineTile<Level, LightingMode::ObservedArea, true> },
+				{ &Renderer::RefineTile<Level, LightingMode::Radiance, false>, &Renderer::RefineTile<Level, LightingMode::Radiance, true> },
+				{ &Renderer::RefineTile<Level, LightingMode::BRDF, false>, &Renderer::RefineTile<Level, LightingMode::BRDF, true> },
+				{ &Renderer::RefineTile<Level, LightingMode::Combined, false>, &Renderer::RefineTile<Level, LightingMode::Combined, true> }
+			} };
+		return kernels;
+	}
+
+	template<SimdLevel Level, Renderer::LightingMode Mode, bool Shadows>
+	SIMD_KERNEL void Renderer::RenderTile(Scene* pScene, uint32_t tileIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const
+	{
+		const auto [startX, startY, endX, endY] { GetTileRect(tileIndex) };
+
+		for (uint32_t py{ startY }; py < endY; ++py)
+		{
+			// adaptive frames start with the corners of the blocks only
+			if (m_IsAdaptiveFrame && !IsGridRow(py))
+				continue;
+
+			// checkerboard frames only trace every other pixel of the row
+			const uint32_t pixelStep{ m_IsAdaptiveFrame ? AdaptiveBlockSize : (m_IsCheckerboardFrame ? 2u : 1u) };
+
+			// full packets first (as wide as this instruction set allows), whatever doesn't fill a packet at the end of the row goes ray by ray
+			uint32_t px{ IsTracedPixel(startX, py) ? startX : startX + 1 };
+			if (m_IsAdaptiveFrame)
+				px = (startX + AdaptiveBlockSize - 1) / AdaptiveBlockSize * AdaptiveBlockSize;
+			px = RenderPackets<Level, CpuFeatures::GetPacketWidth(Level), Mode, Shadows>(pScene, px, endX, pixelStep, py, camera, lights, materials);
+			for (; px < endX; px += pixelStep)
+			{
+				RenderPixel<Level, Mode, Shadows>(pScene, px + (py * m_Width), camera, lights, materials);
+			}
+
+			// the last column isn't on the grid for most widths
+			const uint32_t lastX{ static_cast<uint32_t>(m_Width) - 1 };
+			if (m_IsAdaptiveFrame && endX - 1 == lastX && lastX % AdaptiveBlockSize != 0)
+				RenderPixel<Level, Mode, Shadows>(pScene, lastX + (py * m_Width), camera, lights, materials);
+		}
+	}
+
+	template<SimdLevel Level, Renderer::LightingMode Mode, bool Shadows>
+	SIMD_KERNEL void Renderer::RefineTile(Scene* pScene, uint32_t tileIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const
+	{
+		const auto [startX, startY, endX, endY] { GetTileRect(tileIndex) };
+		const uint32_t width{ static_cast<uint32_t>(m_Width) };
+		const uint32_t height{ static_cast<uint32_t>(m_Height) };
+
+		// blocks can stick out of the tile, every tile only writes the part inside it, the corners are only read
+		for (uint32_t blockY{ startY / AdaptiveBlockSize * AdaptiveBlockSize }; blockY < endY; blockY += AdaptiveBlockSize)
+		{
+			for (uint32_t blockX{ startX / AdaptiveBlockSize * AdaptiveBlockSize }; blockX < endX; blockX += AdaptiveBlockSize)
+			{
+				const uint32_t x0{ blockX };
+				const uint32_t y0{ blockY };
+				const uint32_t x1{ std::min(blockX + AdaptiveBlockSize, width - 1) };
+				const uint32_t y1{ std::min(blockY + AdaptiveBlockSize, height - 1) };
+				const uint32_t corners[4]{ x0 + y0 * width, x1 + y0 * width, x0 + y1 * width, x1 + y1 * width };
+
+				const uint32_t fromX{ std::max(blockX, startX) };
+				const uint32_t toX{ std::min(blockX + AdaptiveBlockSize, endX) };
+				const uint32_t fromY{ std::max(blockY, startY) };
+				const uint32_t toY{ std::min(blockY + AdaptiveBlockSize, endY) };
+
+				if (!IsUniformBlock(corners))
+				{
+					for (uint32_t py{ fromY }; py < toY; ++py)
+					{
+						// the rest of the row in one packet when the whole block is inside the tile
+						uint32_t px{ fromX };
+						if (!IsGridRow(py))
+							px = RenderPackets<Level, AdaptiveBlockSize, Mode, Shadows>(pScene, px, toX, 1, py, camera, lights, materials);
+
+						for (; px < toX; ++px)
+						{
+							if (!IsGridRow(py) || !IsGridColumn(px))
+								RenderPixel<Level, Mode, Shadows>(pScene, px + py * width, camera, lights, materials);
+						}
+					}
+					continue;
+				}
+
+				const ColorRGB colors[4]{ m_FrameBuffer.GetPixel(corners[0]), m_FrameBuffer.GetPixel(corners[1]), m_FrameBuffer.GetPixel(corners[2]), m_FrameBuffer.GetPixel(corners[3]) };
+				const bool isMiss{ m_DepthBuffer[corners[0]] == FLT_MAX };
+
+				for (uint32_t py{ fromY }; py < toY; ++py)
+				{
+					const float fy{ (y1 > y0) ? static_cast<float>(py - y0) / (y1 - y0) : 0.f };
+					for (uint32_t px{ fromX }; px < toX; ++px)
+					{
+						if (IsGridRow(py) && IsGridColumn(px))
+							continue;
+
+						const float fx{ (x1 > x0) ? static_cast<float>(px - x0) / (x1 - x0) : 0.f };
+						const float weights[4]{ (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy };
+
+						ColorRGB color{};
+						float depth{};
+						for (int i{ 0 }; i < 4; ++i)
+						{
+							color += colors[i] * weights[i];
+							depth += isMiss ? 0.f : m_DepthBuffer[corners[i]] * weights[i];
+						}
+
+						const uint32_t pixelIndex{ px + py * width };
+						m_FrameBuffer.AddSample(pixelIndex, color);
+						m_DepthBuffer[pixelIndex] = isMiss ? FLT_MAX : depth;
+						m_ShadingCache[pixelIndex].age = InvalidShadingAge;
+					}
+				}
+			}
+		}
+	}
+
+	template<SimdLevel Level, int N, Renderer::LightingMode Mode, bool Shadows>
+	SIMD_KERNEL uint32_t Renderer::RenderPackets(Scene* pScene, uint32_t startX, uint32_t endX, uint32_t pixelStep, uint32_t py, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const
+	{
+		uint32_t px{ startX };
+		for (; px + (N - 1) * pixelStep < endX; px += N * pixelStep)
+		{
+			RenderPacket<Level, N, Mode, Shadows>(pScene, px, pixelStep, py, camera, lights, materials);
+		}
+		return px;
+	}
+
+	template<SimdLevel Level, int N, Renderer::LightingMode Mode, bool Shadows>
+	void Renderer::RenderPacket(Scene* pScene, uint32_t startX, uint32_t pixelStep, uint32_t py, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const
+	{
+		using vfloat = simd::vfloat<N>;
+
+		// N pixels of one row, same math as RenderPixel
+		const vfloat px{ vfloat{ static_cast<float>(startX) } + vfloat::LaneIndex() * vfloat{ static_cast<float>(pixelStep) } };
+		const vfloat cx{ ((vfloat{ 2.f } * (px + vfloat{ m_SampleOffsetX })) / vfloat{ static_cast<float>(m_Width) } - vfloat{ 1.f }) * vfloat{ m_AspectRatio * camera.fov } };
+		const vfloat cy{ (1.f - ((2.f * (py + m_SampleOffsetY)) / m_Height)) * camera.fov };
+
+		const Vector4& right{ camera.cameraToWorld[0] };
+		const Vector4& up{ camera.cameraToWorld[1] };
+		const Vector4& forward{ camera.cameraToWorld[2] };
+
+		RayPacket<N> viewRay{};
+		viewRay.directionX = cx * vfloat{ right.x } + cy * vfloat{ up.x } + vfloat{ forward.x };
+		viewRay.directionY = cx * vfloat{ right.y } + cy * vfloat{ up.y } + vfloat{ forward.y };
+		viewRay.directionZ = cx * vfloat{ right.z } + cy * vfloat{ up.z } + vfloat{ forward.z };
+
+		const vfloat invLength{ vfloat{ 1.f } / Sqrt(viewRay.directionX * viewRay.directionX + viewRay.directionY * viewRay.directionY + viewRay.directionZ * viewRay.directionZ) };
+		viewRay.directionX = viewRay.directionX * invLength;
+		viewRay.directionY = viewRay.directionY * invLength;
+		viewRay.directionZ = viewRay.directionZ * invLength;
+
+		// packets that would split up in the BVH don't gain anything, trace those ray by ray
+		if (!viewRay.IsCoherent())
+		{
+			for (int lane{ 0 }; lane < N; ++lane)
+			{
+				RenderPixel<Level, Mode, Shadows>(pScene, startX + lane * pixelStep + (py * m_Width), camera, lights, materials);
+			}
+			return;
+		}
+
+		viewRay.originX = vfloat{ camera.origin.x };
+		viewRay.originY = vfloat{ camera.origin.y };
+		viewRay.originZ = vfloat{ camera.origin.z };
+		viewRay.inverseDirectionX = vfloat{ 1.f } / viewRay.directionX;
+		viewRay.inverseDirectionY = vfloat{ 1.f } / viewRay.directionY;
+		viewRay.inverseDirectionZ = vfloat{ 1.f } / viewRay.directionZ;
+
+		PacketHitRecord<N> closestHit{};
+		pScene->GetClosestHitPacket<Level>(viewRay, closestHit);
+
+		// the lanes get shaded in batches of the same material type, the misses go with SolidColor (they don't look at the material)
+		int typeMasks[4]{};
+		for (int lane{ 0 }; lane < N; ++lane)
+		{
+			const HitRecord& hit{ closestHit.hits[lane] };
+			const MaterialType type{ hit.didHit ? materials[hit.materialIndex].type : MaterialType::SolidColor };
+			typeMasks[static_cast<int>(type)] |= 1 << lane;
+		}
+
+		ShadeLanes<Level, MaterialType::SolidColor, N, Mode, Shadows>(pScene, typeMasks[static_cast<int>(MaterialType::SolidColor)], startX, pixelStep, py, closestHit, viewRay, lights, materials);
+		ShadeLanes<Level, MaterialType::Lambert, N, Mode, Shadows>(pScene, typeMasks[static_cast<int>(MaterialType::Lambert)], startX, pixelStep, py, closestHit, viewRay, lights, materials);
+		ShadeLanes<Level, MaterialType::LambertPhong, N, Mode, Shadows>(pScene, typeMasks[static_cast<int>(MaterialType::LambertPhong)], startX, pixelStep, py, closestHit, viewRay, lights, materials);
+		ShadeLanes<Level, MaterialType::CookTorrence, N, Mode, Shadows>(pScene, typeMasks[static_cast<int>(MaterialType::CookTorrence)], startX, pixelStep, py, closestHit, viewRay, lights, materials);
+	}
+
+	template<SimdLevel Level, MaterialType Type, int N, Renderer::LightingMode Mode, bool Shadows>
+	void Renderer::ShadeLanes(Scene* pScene, int laneMask, uint32_t startX, uint32_t pixelStep, uint32_t py, const PacketHitRecord<N>& closestHit, const RayPacket<N>& viewRay, const std::vector<Light>& lights, const std::vector<Material>& materials) const
+	{
+		// shadow rays stay per pixel
+		for (; laneMask != 0; laneMask &= laneMask - 1)
+		{
+			const int lane{ simd::LowestLane(laneMask) };
+			ShadePixel<Level, Type, Mode, Shadows>(pScene, startX + lane * pixelStep, py, closestHit.hits[lane], viewRay.GetDirection(lane), lights, materials);
+		}
+	}
+
+	template<SimdLevel Level, Renderer::LightingMode Mode, bool Shadows>
+	SIMD_KERNEL void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, const Camera& camera, const std::vector<Light>& lights, const std::vector<Material>& materials) const
+	{
+		const int py = pixelIndex / m_Width;
+		const int px = pixelIndex % m_Width;
+
+		const float cx{ ((2.f * (px + m_SampleOffsetX)) / m_Width - 1) * m_AspectRatio * camera.fov };
+		const float cy{ (1.f - ((2.f * (py + m_SampleOffsetY)) / m_Height)) * camera.fov };
+
+		Vector3 rayDirection{ cx, cy , 1 };
+		rayDirection = camera.cameraToWorld.TransformVector(rayDirection).Normalized();
+
+		Ray viewRay{ camera.origin, rayDirection, {1.0f / rayDirection.x, 1.0f / rayDirection.y, 1.0f / rayDirection.z} };
+
+		HitRecord closestHit{};
+		pScene->GetClosestHit<Level>(viewRay, closestHit);
+
+		ShadePixel<Level, Mode, Shadows>(pScene, px, py, closestHit, rayDirection, lights, materials);
+	}
+
+	template<SimdLevel Level, Renderer::LightingMode Mode, bool Shadows>
+	void Renderer::ShadePixel(Scene* pScene, int px, int py, const HitRecord& closestHit, const Vector3& rayDirection, const std::vector<Light>& lights, const std::vector<Material>& materials) const
+	{
+		switch (closestHit.didHit ? materials[closestHit.materialIndex].type : MaterialType::SolidColor)
+		{
+		case MaterialType::Lambert:
+			ShadePixel<Level, MaterialType::Lambert, Mode, Shadows>(pScene, px, py, closestHit, rayDirection, lights, materials);
+			break;
+		case MaterialType::LambertPhong:
+			ShadePixel<Level, MaterialType::LambertPhong, Mode, Shadows>(pScene, px, py, closestHit, rayDirection, lights, materials);
+			break;
+		case MaterialType::CookTorrence:
+			ShadePixel<Level, MaterialType::CookTorrence, Mode, Shadows>(pScene, px, py, closestHit, rayDirection, lights, materials);
+			break;
+		default:
+			ShadePixel<Level, MaterialType::SolidColor, Mode, Shadows>(pScene, px, py, closestHit, rayDirection, lights, materials);
+			break;
+		}
+	}
+
+	template<SimdLevel Level, MaterialType Type, Renderer::LightingMode Mode, bool Shadows>
+	SIMD_KERNEL void Renderer::ShadePixel(Scene* pScene, int px, int py, const HitRecord& closestHit, const Vector3& rayDirection, const std::vector<Light>& lights, const std::vector<Material>& materials) const
+	{
+		ColorRGB finalColor{};
+
+		// the specular part changes with the view direction, those materials only get reused while it isn't part of the shading
+		constexpr bool isViewDependent{ Mode == LightingMode::BRDF || Mode == LightingMode::Combined };
+		const ShadingCacheEntry* pCachedShading{ (m_IsShadingCacheUsable && closestHit.didHit && !(isViewDependent && Material::IsViewDependent(Type)))
+			? FindCachedShading(closestHit, px, py) : nullptr };
+
+		if (pCachedShading)
+		{
+			finalColor = pCachedShading->color;
+		}
+		else if (closestHit.didHit)
+		{
+			const Vector3 originOffset{ closestHit.origin + closestHit.normal * 0.0001f }; // Use small offset for the ray origin (self-shadowing)
+			const Material& material{ materials[closestHit.materialIndex] };
+			//for (size_t i{ 0 }; i < lights.size(); ++i)
+			for (const Light& currLight: lights)
+			{
+				Vector3 lightDirection{ LightUtils::GetDirectionToLight(currLight, originOffset) };
+				const float lightDistance{ lightDirection.Normalize() }; // normalizing the vector returns the distance
+
+				if constexpr (Shadows)
+				{
+					Ray invLightRay{ originOffset, lightDirection, {1.0f / lightDirection.x, 1.0f / lightDirection.y, 1.0f / lightDirection.z} , 0.0f, lightDistance }; // W2 slide 25
+
+					if (pScene->DoesHit<Level>(invLightRay))
+						continue;
+
+				}
+
+				if constexpr (Mode == LightingMode::ObservedArea)
+				{
+					const float normalLightAngle{ std::max(Vector3::Dot(closestHit.normal, lightDirection), 0.0f )}; // angle between normal and light direction (cosine theta)
+
+					// only multiply if normalLightAngle is bigger then 0, replacement of if statement
+					finalColor += ColorRGB{ normalLightAngle, normalLightAngle, normalLightAngle };
+				}
+				else if constexpr (Mode == LightingMode::Radiance)
+				{
+					finalColor += LightUtils::GetRadiance(currLight, closestHit.origin);
+				}
+				else if constexpr (Mode == LightingMode::BRDF)
+				{
+					finalColor += material.Shade<Type>(closestHit, lightDirection, rayDirection);
+				}
+				else
+				{
+					const float normalLightAngle{ std::max(Vector3::Dot(closestHit.normal, lightDirection), 0.0f )}; // angle between normal and light direction (cosine theta)
+
+					// formula getting too long, making variables...
+
+					const ColorRGB radiance{ LightUtils::GetRadiance(currLight, closestHit.origin) };
+					const ColorRGB brdf{ material.Shade<Type>(closestHit, lightDirection, rayDirection) };
+
+					finalColor += radiance * brdf * normalLightAngle;
+				}
+
+			}
+		}
+
+
+
+		//Update Color in Buffer, tone mapping happens when the tile gets resolved
+		const uint32_t pixelIndex{ static_cast<uint32_t>(px + (py * m_Width)) };
+		m_FrameBuffer.AddSample(pixelIndex, finalColor);
+		m_DepthBuffer[pixelIndex] = closestHit.didHit ? closestHit.t : FLT_MAX;
+		// reused colors keep the point they got shaded for, so they can't drift away from it a pixel per frame
+		m_ShadingCache[pixelIndex] = pCachedShading
+			? ShadingCacheEntry{ pCachedShading->position, finalColor, closestHit.objectId, closestHit.primitiveIndex, pCachedShading->age + 1 }
+			: ShadingCacheEntry{ closestHit.origin, finalColor, closestHit.objectId, closestHit.primitiveIndex, closestHit.didHit ? 0 : InvalidShadingAge };
+	}
+}
@@ -0,0 +1,255 @@
+#pragma once
+#include <cstdint>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "SIMDBuild.h"
+
+// The wider packets get used by the Kernels_*.cpp files, which raise their own target and define these.
+// MSVC lets every translation unit use the AVX/AVX-512 intrinsics, other compilers only when the file targets that instruction set.
+#if !defined(SIMD_AVX2_PACKETS) && (defined(__AVX2__) || defined(_MSC_VER))
+#define SIMD_AVX2_PACKETS
+#endif
+#if !defined(SIMD_AVX512_PACKETS) && (defined(__AVX512F__) || defined(_MSC_VER))
+#define SIMD_AVX512_PACKETS
+#endif
+
+// blendv is SSE4.1, MSVC has no /arch for it but emits the intrinsic in any file, so the SSE4 and wider kernel files ask for it.
+#if !defined(SIMD_SSE4_PACKETS) && defined(__SSE4_1__)
+#define SIMD_SSE4_PACKETS
+#endif
+
+// The free functions below get their own namespace per kernel file (Kernels_*.cpp define it), the rest of the program uses the
+// default one. That way a kernel file never shares a symbol with a copy compiled for another instruction set.
+#if !defined(SIMD_ISA_NAMESPACE)
+#define SIMD_ISA_NAMESPACE build
+#endif
+
+// Marks the entry points of the per instruction set kernels (see Kernels.inl). Everything they call gets inlined into them,
+// so a kernel file never leaves a copy of a shared inline function (Vector3, the vfloat members, ...) behind that the linker
+// could pick for the rest of the program.
+#if defined(__GNUC__)
+#define SIMD_KERNEL __attribute__((flatten, noinline))
+#elif defined(_MSC_VER)
+#define SIMD_KERNEL [[msvc::flatten]] __declspec(noinline)
+#else
+#define SIMD_KERNEL
+#endif
+
+namespace dae
+{
+	namespace simd
+	{
+		// Thin wrappers around the SSE/AVX registers, so the packet code can be written once for 4, 8 and 16 lanes.
+		// Comparisons return a vfloat with all bits set in the lanes where the comparison holds (like the intrinsics do).
+		template<int N>
+		struct vfloat;
+
+#pragma region vfloat 4 (SSE)
+		template<>
+		struct vfloat<4>
+		{
+			static constexpr int Width{ 4 };
+
+			__m128 v;
+
+			vfloat() = default;
+			vfloat(__m128 _v) : v{ _v } {}
+			explicit vfloat(float f) : v{ _mm_set1_ps(f) } {}
+
+			static vfloat Load(const float* p) { return _mm_loadu_ps(p); }
+			void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+			static vfloat Zero() { return _mm_setzero_ps(); }
+			static vfloat AllBits() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+			// 0, 1, 2, 3
+			static vfloat LaneIndex() { return _mm_setr_ps(0.f, 1.f, 2.f, 3.f); }
+
+			float operator[](int lane) const
+			{
+				alignas(16) float lanes[Width];
+				_mm_store_ps(lanes, v);
+				return lanes[lane];
+			}
+		};
+
+		// The operators are free functions instead of friends defined in the class, GCC doesn't apply a #pragma GCC target
+		// of the kernel files to those (and then refuses to inline the intrinsics into them).
+		inline namespace SIMD_ISA_NAMESPACE
+		{
+			inline vfloat<4> operator+(vfloat<4> a, vfloat<4> b) { return _mm_add_ps(a.v, b.v); }
+			inline vfloat<4> operator-(vfloat<4> a, vfloat<4> b) { return _mm_sub_ps(a.v, b.v); }
+			inline vfloat<4> operator*(vfloat<4> a, vfloat<4> b) { return _mm_mul_ps(a.v, b.v); }
+			inline vfloat<4> operator/(vfloat<4> a, vfloat<4> b) { return _mm_div_ps(a.v, b.v); }
+			inline vfloat<4> operator-(vfloat<4> a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.f)); }
+
+			inline vfloat<4> operator&(vfloat<4> a, vfloat<4> b) { return _mm_and_ps(a.v, b.v); }
+			inline vfloat<4> operator|(vfloat<4> a, vfloat<4> b) { return _mm_or_ps(a.v, b.v); }
+			inline vfloat<4> AndNot(vfloat<4> a, vfloat<4> b) { return _mm_andnot_ps(a.v, b.v); } // ~a & b
+
+			inline vfloat<4> operator<(vfloat<4> a, vfloat<4> b) { return _mm_cmplt_ps(a.v, b.v); }
+			inline vfloat<4> operator<=(vfloat<4> a, vfloat<4> b) { return _mm_cmple_ps(a.v, b.v); }
+			inline vfloat<4> operator>(vfloat<4> a, vfloat<4> b) { return _mm_cmpgt_ps(a.v, b.v); }
+			inline vfloat<4> operator>=(vfloat<4> a, vfloat<4> b) { return _mm_cmpge_ps(a.v, b.v); }
+
+			inline vfloat<4> Min(vfloat<4> a, vfloat<4> b) { return _mm_min_ps(a.v, b.v); }
+			inline vfloat<4> Max(vfloat<4> a, vfloat<4> b) { return _mm_max_ps(a.v, b.v); }
+			inline vfloat<4> Sqrt(vfloat<4> a) { return _mm_sqrt_ps(a.v); }
+
+			// mask ? a : b, without blendv the masks (all bits or none per lane) select with plain logic ops
+#if defined(SIMD_SSE4_PACKETS)
+			inline vfloat<4> Select(vfloat<4> mask, vfloat<4> a, vfloat<4> b) { return _mm_blendv_ps(b.v, a.v, mask.v); }
+#else
+			inline vfloat<4> Select(vfloat<4> mask, vfloat<4> a, vfloat<4> b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+#endif
+			// one bit per lane
+			inline int MoveMask(vfloat<4> mask) { return _mm_movemask_ps(mask.v); }
+		}
+#pragma endregion
+
+#if defined(SIMD_AVX2_PACKETS)
+#pragma region vfloat 8 (AVX2)
+		template<>
+		struct vfloat<8>
+		{
+			static constexpr int Width{ 8 };
+
+			__m256 v;
+
+			vfloat() = default;
+			vfloat(__m256 _v) : v{ _v } {}
+			explicit vfloat(float f) : v{ _mm256_set1_ps(f) } {}
+
+			static vfloat Load(const float* p) { return _mm256_loadu_ps(p); }
+			void Store(float* p) const { _mm256_storeu_ps(p, v); }
+
+			static vfloat Zero() { return _mm256_setzero_ps(); }
+			static vfloat AllBits() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+			// 0, 1, 2, ... 7
+			static vfloat LaneIndex() { return _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f); }
+
+			float operator[](int lane) const
+			{
+				alignas(32) float lanes[Width];
+				_mm256_store_ps(lanes, v);
+				return lanes[lane];
+			}
+		};
+
+		inline namespace SIMD_ISA_NAMESPACE
+		{
+			inline vfloat<8> operator+(vfloat<8> a, vfloat<8> b) { return _mm256_add_ps(a.v, b.v); }
+			inline vfloat<8> operator-(vfloat<8> a, vfloat<8> b) { return _mm256_sub_ps(a.v, b.v); }
+			inline vfloat<8> operator*(vfloat<8> a, vfloat<8> b) { return _mm256_mul_ps(a.v, b.v); }
+			inline vfloat<8> operator/(vfloat<8> a, vfloat<8> b) { return _mm256_div_ps(a.v, b.v); }
+			inline vfloat<8> operator-(vfloat<8> a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.f)); }
+
+			inline vfloat<8> operator&(vfloat<8> a, vfloat<8> b) { return _mm256_and_ps(a.v, b.v); }
+			inline vfloat<8> operator|(vfloat<8> a, vfloat<8> b) { return _mm256_or_ps(a.v, b.v); }
+			inline vfloat<8> AndNot(vfloat<8> a, vfloat<8> b) { return _mm256_andnot_ps(a.v, b.v); } // ~a & b
+
+			inline vfloat<8> operator<(vfloat<8> a, vfloat<8> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+			inline vfloat<8> operator<=(vfloat<8> a, vfloat<8> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+			inline vfloat<8> operator>(vfloat<8> a, vfloat<8> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+			inline vfloat<8> operator>=(vfloat<8> a, vfloat<8> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+
+			inline vfloat<8> Min(vfloat<8> a, vfloat<8> b) { return _mm256_min_ps(a.v, b.v); }
+			inline vfloat<8> Max(vfloat<8> a, vfloat<8> b) { return _mm256_max_ps(a.v, b.v); }
+			inline vfloat<8> Sqrt(vfloat<8> a) { return _mm256_sqrt_ps(a.v); }
+
+			// mask ? a : b
+			inline vfloat<8> Select(vfloat<8> mask, vfloat<8> a, vfloat<8> b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+			// one bit per lane
+			inline int MoveMask(vfloat<8> mask) { return _mm256_movemask_ps(mask.v); }
+		}
+#pragma endregion
+#endif
+
+#if defined(SIMD_AVX512_PACKETS)
+#pragma region vfloat 16 (AVX-512F)
+		// AVX-512 compares into mask registers, the masks get expanded back into all-bits lanes so this behaves like the others.
+		// Only uses AVX-512F, the float logic ops (DQ) are done on the integer side.
+		template<>
+		struct vfloat<16>
+		{
+			static constexpr int Width{ 16 };
+
+			__m512 v;
+
+			vfloat() = default;
+			vfloat(__m512 _v) : v{ _v } {}
+			explicit vfloat(float f) : v{ _mm512_set1_ps(f) } {}
+
+			static vfloat Load(const float* p) { return _mm512_loadu_ps(p); }
+			void Store(float* p) const { _mm512_storeu_ps(p, v); }
+
+			static vfloat Zero() { return _mm512_setzero_ps(); }
+			static vfloat AllBits() { return _mm512_castsi512_ps(_mm512_set1_epi32(-1)); }
+			// 0, 1, 2, ... 15
+			static vfloat LaneIndex() { return _mm512_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f); }
+
+			static vfloat FromMask(__mmask16 mask) { return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(mask, -1)); }
+			// sign bit of every lane, same as movemask
+			static __mmask16 ToMask(vfloat mask) { return _mm512_cmplt_epi32_mask(_mm512_castps_si512(mask.v), _mm512_setzero_si512()); }
+
+			float operator[](int lane) const
+			{
+				alignas(64) float lanes[Width];
+				_mm512_store_ps(lanes, v);
+				return lanes[lane];
+			}
+		};
+
+		inline namespace SIMD_ISA_NAMESPACE
+		{
+			inline vfloat<16> operator+(vfloat<16> a, vfloat<16> b) { return _mm512_add_ps(a.v, b.v); }
+			inline vfloat<16> operator-(vfloat<16> a, vfloat<16> b) { return _mm512_sub_ps(a.v, b.v); }
+			inline vfloat<16> operator*(vfloat<16> a, vfloat<16> b) { return _mm512_mul_ps(a.v, b.v); }
+			inline vfloat<16> operator/(vfloat<16> a, vfloat<16> b) { return _mm512_div_ps(a.v, b.v); }
+			inline vfloat<16> operator-(vfloat<16> a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a.v), _mm512_set1_epi32(INT32_MIN))); }
+
+			inline vfloat<16> operator&(vfloat<16> a, vfloat<16> b) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a.v), _mm512_castps_si512(b.v))); }
+			inline vfloat<16> operator|(vfloat<16> a, vfloat<16> b) { return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a.v), _mm512_castps_si512(b.v))); }
+			inline vfloat<16> AndNot(vfloat<16> a, vfloat<16> b) { return _mm512_castsi512_ps(_mm512_andnot_si512(_mm512_castps_si512(a.v), _mm512_castps_si512(b.v))); } // ~a & b
+
+			inline vfloat<16> operator<(vfloat<16> a, vfloat<16> b) { return vfloat<16>::FromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ)); }
+			inline vfloat<16> operator<=(vfloat<16> a, vfloat<16> b) { return vfloat<16>::FromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ)); }
+			inline vfloat<16> operator>(vfloat<16> a, vfloat<16> b) { return vfloat<16>::FromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ)); }
+			inline vfloat<16> operator>=(vfloat<16> a, vfloat<16> b) { return vfloat<16>::FromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ)); }
+
+			inline vfloat<16> Min(vfloat<16> a, vfloat<16> b) { return _mm512_min_ps(a.v, b.v); }
+			inline vfloat<16> Max(vfloat<16> a, vfloat<16> b) { return _mm512_max_ps(a.v, b.v); }
+			inline vfloat<16> Sqrt(vfloat<16> a) { return _mm512_sqrt_ps(a.v); }
+
+			// mask ? a : b
+			inline vfloat<16> Select(vfloat<16> mask, vfloat<16> a, vfloat<16> b) { return _mm512_mask_blend_ps(vfloat<16>::ToMask(mask), b.v, a.v); }
+			// one bit per lane
+			inline int MoveMask(vfloat<16> mask) { return static_cast<int>(vfloat<16>::ToMask(mask)); }
+		}
+#pragma endregion
+#endif
+
+		// widest packet the build target guarantees, the wide BVH nodes are laid out for it
+		constexpr int PacketWidth{ SIMD_BUILD_PACKET_WIDTH };
+
+		template<int N>
+		constexpr int FullMask() { return (1 << N) - 1; }
+
+		inline namespace SIMD_ISA_NAMESPACE
+		{
+			// index of the lowest set bit, used to walk the lanes of a movemask
+			inline int LowestLane(int bits)
+			{
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanForward(&index, static_cast<unsigned long>(bits));
+				return static_cast<int>(index);
+#else
+				return __builtin_ctz(static_cast<unsigned int>(bits));
+#endif
+			}
+		}
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// What the build target itself guarantees. The Kernels_*.cpp files include this before raising their own target,
+// so the data layouts they share with the rest of the program (the wide BVH nodes) stay the same.
+// MSVC raises the target of those files with a per file /arch instead (see the project), __AVX2__ is defined in them
+// without saying anything about the rest of the program, so MSVC builds keep the 4 lane layout.
+#if !defined(SIMD_BUILD_PACKET_WIDTH)
+#if defined(__AVX2__) && !defined(_MSC_VER)
+#define SIMD_BUILD_PACKET_WIDTH 8
+#else
+#define SIMD_BUILD_PACKET_WIDTH 4
+#endif
+#endif
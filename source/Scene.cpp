@@ -1,94 +1,341 @@
 #include "Scene.h"
 #include "Utils.h"
 #include "Material.h"
+#include "MeshFile.h"
 
 namespace dae {
 
 #pragma region Base Scene
 	//Initialize Scene with Default Solid Color Material (RED)
 	Scene::Scene():
-		m_Materials({ new Material_SolidColor({1,0,0})})
+		m_Materials({ Material::CreateSolidColor({1,0,0})})
 	{
 		m_SphereGeometries.reserve(32);
 		m_PlaneGeometries.reserve(32);
 		m_TriangleMeshGeometries.reserve(32);
+		m_TriangleMeshInstances.reserve(32);
 		m_Lights.reserve(32);
 	}
 
-	Scene::~Scene()
+	Scene::~Scene() = default;
+
+#pragma region Top Level BVH
+	void Scene::UpdateTopLevelBVH()
 	{
-		for(auto& pMaterial : m_Materials)
+		// the mesh itself might have changed (UpdateBVH) without the instance knowing about it
+		for (TriangleMeshInstance& instance : m_TriangleMeshInstances)
+		{
+			instance.UpdateAABB();
+		}
+
+		// objects only get added during Initialize, so a different count means we have to rebuild
+		if (m_TopLevelPrimitives.size() != m_SphereGeometries.size() + m_TriangleMeshInstances.size())
+		{
+			BuildTopLevelBVH();
+		}
+		else
 		{
-			delete pMaterial;
-			pMaterial = nullptr;
+			RefitTopLevelBVH();
+
+			// the tree stays valid, but objects moving apart keep on growing the boxes (same as TriangleMesh::UpdateBVH)
+			if (CalculateTopLevelSAHCost() > m_TopLevelBuiltSAHCost * BVHRebuildThreshold)
+				BuildTopLevelBVH();
 		}
 
-		m_Materials.clear();
+		UpdateStateVersion();
 	}
 
-	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
+	void Scene::UpdateStateVersion()
 	{
-		HitRecord tempHit{};
-
-		for (const Sphere& currSphere : m_SphereGeometries)
+		// compares everything that can move against last frame's snapshot while overwriting it
+		size_t stateIdx{ 0 };
+		bool hasChanged{ false };
+		const auto record = [&](const float* pValues, size_t count)
+			{
+				if (m_StateSnapshot.size() < stateIdx + count)
+				{
+					m_StateSnapshot.resize(stateIdx + count);
+					hasChanged = true;
+				}
+
+				for (size_t i{ 0 }; i < count; ++i, ++stateIdx)
+				{
+					if (m_StateSnapshot[stateIdx] != pValues[i])
+					{
+						m_StateSnapshot[stateIdx] = pValues[i];
+						hasChanged = true;
+					}
+				}
+			};
+
+		for (const Plane& plane : m_PlaneGeometries)
+		{
+			record(&plane.origin.x, 3);
+			record(&plane.normal.x, 3);
+		}
+		for (const Sphere& sphere : m_SphereGeometries)
+		{
+			record(&sphere.origin.x, 3);
+			record(&sphere.radius, 1);
+		}
+		for (const std::unique_ptr<TriangleMesh>& pMesh : m_TriangleMeshGeometries)
+		{
+			// a deformed mesh only shows up through its version, split in halves that fit a float exactly
+			const float version[2]{ static_cast<float>(pMesh->bvhVersion & 0xFFFF), static_cast<float>(pMesh->bvhVersion >> 16) };
+			record(version, 2);
+		}
+		for (const TriangleMeshInstance& instance : m_TriangleMeshInstances)
 		{
-			
-			if ( GeometryUtils::HitTest_Sphere(currSphere, ray, tempHit) && tempHit.t < closestHit.t)
+			for (int row{ 0 }; row < 4; ++row)
 			{
-				closestHit = tempHit;
-				closestHit.normal.Normalize();
+				const Vector4 values{ instance.objectToWorld[row] };
+				record(&values.x, 4);
 			}
 		}
+		for (const Light& light : m_Lights)
+		{
+			record(&light.origin.x, 3);
+			record(&light.direction.x, 3);
+			record(&light.color.r, 3);
+			record(&light.intensity, 1);
+		}
 
-		for (const Plane& currPlane : m_PlaneGeometries)
+		if (stateIdx != m_StateSnapshot.size())
 		{
-			
-			if (GeometryUtils::HitTest_Plane(currPlane, ray, tempHit) && tempHit.t < closestHit.t)
-			{
-				closestHit = tempHit;
-			}
-		
+			m_StateSnapshot.resize(stateIdx);
+			hasChanged = true;
+		}
+
+		if (hasChanged)
+			++m_StateVersion;
+	}
+
+	void Scene::BuildTopLevelBVH()
+	{
+		m_TopLevelPrimitives.clear();
+		m_TopLevelPrimitives.reserve(m_SphereGeometries.size() + m_TriangleMeshInstances.size());
+
+		for (unsigned int i{ 0 }; i < static_cast<unsigned int>(m_SphereGeometries.size()); ++i)
+		{
+			m_TopLevelPrimitives.push_back({ {}, {}, {}, TopLevelPrimitiveType::Sphere, i });
 		}
-		
-		for (const TriangleMesh& currTriangleMesh: m_TriangleMeshGeometries)
+		for (unsigned int i{ 0 }; i < static_cast<unsigned int>(m_TriangleMeshInstances.size()); ++i)
 		{
-			
-			if (GeometryUtils::HitTest_TriangleMesh(currTriangleMesh, ray, tempHit) && tempHit.t < closestHit.t)
-			{
-				closestHit = tempHit;
-			}
+			m_TopLevelPrimitives.push_back({ {}, {}, {}, TopLevelPrimitiveType::TriangleMeshInstance, i });
+		}
+
+		for (TopLevelPrimitive& primitive : m_TopLevelPrimitives)
+		{
+			UpdateTopLevelPrimitiveBounds(primitive);
 		}
+
+		m_TopLevelNodes.clear();
+		m_TopLevelNodesUsed = 0;
+		if (m_TopLevelPrimitives.empty())
+			return;
+
+		// a binary tree with N leaves never has more than 2N - 1 nodes
+		m_TopLevelNodes.resize(m_TopLevelPrimitives.size() * 2);
+
+		TopLevelBVHNode& root = m_TopLevelNodes[0];
+		root.leftNode = 0;
+		root.firstPrimIdx = 0;
+		root.primCount = static_cast<unsigned int>(m_TopLevelPrimitives.size());
+
+		UpdateTopLevelNodeBounds(0);
+		SubdivideTopLevel(0, 0);
+
+		m_TopLevelBuiltSAHCost = CalculateTopLevelSAHCost();
 	}
 
-	bool Scene::DoesHit(const Ray& ray) const
+	void Scene::SubdivideTopLevel(unsigned int nodeIdx, unsigned int depth)
 	{
-		for (const Sphere& currSphere : m_SphereGeometries)
+		// same binned SAH approach as the mesh BVH, only on whole objects
+		TopLevelBVHNode& node = m_TopLevelNodes[nodeIdx];
+		if (node.primCount <= 1 || depth >= BVHMaxDepth) return;
+
+		const int nrOfBins{ 8 };
+		int bestAxis{ -1 };
+		float bestPos{ 0 };
+		float bestCost{ FLT_MAX };
+
+		for (int axis{ 0 }; axis < 3; ++axis)
 		{
-			if (GeometryUtils::HitTest_Sphere(currSphere, ray))
+			float boundsMin{ FLT_MAX };
+			float boundsMax{ -FLT_MAX };
+			for (unsigned int i{ 0 }; i < node.primCount; ++i)
 			{
-				return true;
+				const float centroid{ m_TopLevelPrimitives[node.firstPrimIdx + i].centroid[axis] };
+				boundsMin = std::min(boundsMin, centroid);
+				boundsMax = std::max(boundsMax, centroid);
 			}
-		}
+			if (boundsMin == boundsMax) continue;
 
-		for (const Plane& currPlane : m_PlaneGeometries)
-		{
-			if (GeometryUtils::HitTest_Plane(currPlane, ray))
+			Bin bin[nrOfBins];
+			const float scale{ nrOfBins / (boundsMax - boundsMin) };
+			for (unsigned int i{ 0 }; i < node.primCount; ++i)
+			{
+				const TopLevelPrimitive& primitive{ m_TopLevelPrimitives[node.firstPrimIdx + i] };
+				const int binIdx{ std::min(nrOfBins - 1, static_cast<int>((primitive.centroid[axis] - boundsMin) * scale)) };
+
+				++bin[binIdx].triCount;
+				bin[binIdx].bounds.Grow(primitive.minAABB);
+				bin[binIdx].bounds.Grow(primitive.maxAABB);
+			}
+
+			// sweep over the planes between the bins
+			for (int i{ 1 }; i < nrOfBins; ++i)
 			{
-				return true;
+				aabb leftBox{};
+				aabb rightBox{};
+				int leftCount{ 0 };
+				int rightCount{ 0 };
+				for (int j{ 0 }; j < i; ++j)
+				{
+					leftCount += bin[j].triCount;
+					if (bin[j].triCount > 0) leftBox.Grow(bin[j].bounds);
+				}
+				for (int j{ i }; j < nrOfBins; ++j)
+				{
+					rightCount += bin[j].triCount;
+					if (bin[j].triCount > 0) rightBox.Grow(bin[j].bounds);
+				}
+				if (leftCount == 0 || rightCount == 0) continue;
+
+				const float planeCost{ leftCount * leftBox.Area() + rightCount * rightBox.Area() };
+				if (planeCost < bestCost)
+				{
+					bestAxis = axis;
+					bestPos = boundsMin + (boundsMax - boundsMin) / nrOfBins * i;
+					bestCost = planeCost;
+				}
 			}
 		}
 
-		for (const TriangleMesh& currTriangleMesh : m_TriangleMeshGeometries)
+		if (bestAxis == -1) return;
+
+		const Vector3 extent{ node.maxAABB - node.minAABB };
+		const float noSplitCost{ node.primCount * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x) };
+		if (bestCost >= noSplitCost) return;
+
+		// in-place partition
+		unsigned int i{ node.firstPrimIdx };
+		unsigned int j{ node.firstPrimIdx + node.primCount };
+		while (i < j)
+		{
+			if (m_TopLevelPrimitives[i].centroid[bestAxis] < bestPos)
+				++i;
+			else
+				std::swap(m_TopLevelPrimitives[i], m_TopLevelPrimitives[--j]);
+		}
+
+		const unsigned int leftCount{ i - node.firstPrimIdx };
+		if (leftCount == 0 || leftCount == node.primCount) return;
+
+		// create child nodes
+		const unsigned int leftChildIdx{ ++m_TopLevelNodesUsed };
+		const unsigned int rightChildIdx{ ++m_TopLevelNodesUsed };
+		m_TopLevelNodes[leftChildIdx].firstPrimIdx = node.firstPrimIdx;
+		m_TopLevelNodes[leftChildIdx].primCount = leftCount;
+		m_TopLevelNodes[rightChildIdx].firstPrimIdx = i;
+		m_TopLevelNodes[rightChildIdx].primCount = node.primCount - leftCount;
+		node.leftNode = leftChildIdx;
+		node.primCount = 0;
+
+		UpdateTopLevelNodeBounds(leftChildIdx);
+		UpdateTopLevelNodeBounds(rightChildIdx);
+
+		SubdivideTopLevel(leftChildIdx, depth + 1);
+		SubdivideTopLevel(rightChildIdx, depth + 1);
+	}
+
+	void Scene::RefitTopLevelBVH()
+	{
+		for (TopLevelPrimitive& primitive : m_TopLevelPrimitives)
+		{
+			UpdateTopLevelPrimitiveBounds(primitive);
+		}
+
+		// children always have a higher index than their parent, so walking backwards is bottom-up
+		for (int nodeIdx{ static_cast<int>(m_TopLevelNodesUsed) }; nodeIdx >= 0; --nodeIdx)
 		{
-			if (GeometryUtils::HitTest_TriangleMesh(currTriangleMesh, ray))
+			TopLevelBVHNode& node = m_TopLevelNodes[nodeIdx];
+			if (node.IsLeaf())
 			{
-				return true;
+				UpdateTopLevelNodeBounds(nodeIdx);
+				continue;
 			}
+
+			const TopLevelBVHNode& leftChild = m_TopLevelNodes[node.leftNode];
+			const TopLevelBVHNode& rightChild = m_TopLevelNodes[node.leftNode + 1];
+			node.minAABB = Vector3::Min(leftChild.minAABB, rightChild.minAABB);
+			node.maxAABB = Vector3::Max(leftChild.maxAABB, rightChild.maxAABB);
+		}
+	}
+
+	float Scene::CalculateTopLevelSAHCost() const
+	{
+		// same cost as TriangleMesh::CalculateSAHCost, with the primitives of a leaf in place of its triangles
+		if (m_TopLevelNodes.empty())
+			return 0.f;
+
+		const float traversalCost{ 1.f };
+		float cost{};
+		for (unsigned int nodeIdx{ 0 }; nodeIdx <= m_TopLevelNodesUsed; ++nodeIdx)
+		{
+			const TopLevelBVHNode& node = m_TopLevelNodes[nodeIdx];
+			const Vector3 extent{ node.maxAABB - node.minAABB };
+			const float surfaceArea{ extent.x * extent.y + extent.y * extent.z + extent.z * extent.x };
+
+			cost += surfaceArea * (node.IsLeaf() ? static_cast<float>(node.primCount) : traversalCost);
+		}
+
+		const TopLevelBVHNode& root = m_TopLevelNodes[0];
+		const Vector3 rootExtent{ root.maxAABB - root.minAABB };
+		const float rootArea{ rootExtent.x * rootExtent.y + rootExtent.y * rootExtent.z + rootExtent.z * rootExtent.x };
+		return rootArea > 0 ? cost / rootArea : 0.f;
+	}
+
+	void Scene::UpdateTopLevelPrimitiveBounds(TopLevelPrimitive& primitive) const
+	{
+		switch (primitive.type)
+		{
+		case TopLevelPrimitiveType::Sphere:
+		{
+			const Sphere& sphere{ m_SphereGeometries[primitive.index] };
+			const Vector3 radius{ sphere.radius, sphere.radius, sphere.radius };
+			primitive.minAABB = sphere.origin - radius;
+			primitive.maxAABB = sphere.origin + radius;
+		}
+			break;
+		case TopLevelPrimitiveType::TriangleMeshInstance:
+		{
+			const TriangleMeshInstance& instance{ m_TriangleMeshInstances[primitive.index] };
+			primitive.minAABB = instance.minAABB;
+			primitive.maxAABB = instance.maxAABB;
 		}
+			break;
+		}
+
+		primitive.centroid = (primitive.minAABB + primitive.maxAABB) * 0.5f;
+	}
 
-		return false;
+	void Scene::UpdateTopLevelNodeBounds(unsigned int nodeIdx)
+	{
+		TopLevelBVHNode& node = m_TopLevelNodes[nodeIdx];
+
+		node.minAABB = Vector3::MaxFloat;
+		node.maxAABB = -Vector3::MaxFloat;
+
+		for (unsigned int i{ 0 }; i < node.primCount; ++i)
+		{
+			node.minAABB = Vector3::Min(node.minAABB, m_TopLevelPrimitives[node.firstPrimIdx + i].minAABB);
+			node.maxAABB = Vector3::Max(node.maxAABB, m_TopLevelPrimitives[node.firstPrimIdx + i].maxAABB);
+		}
 	}
 
+#pragma endregion
+
 #pragma region Scene Helpers
 	Sphere* Scene::AddSphere(const Vector3& origin, float radius, unsigned char materialIndex)
 	{
@@ -96,6 +343,7 @@ namespace dae {
 		s.origin = origin;
 		s.radius = radius;
 		s.materialIndex = materialIndex;
+		s.objectId = m_NextObjectId++;
 
 		m_SphereGeometries.emplace_back(s);
 		return &m_SphereGeometries.back();
@@ -107,19 +355,38 @@ namespace dae {
 		p.origin = origin;
 		p.normal = normal;
 		p.materialIndex = materialIndex;
+		p.objectId = m_NextObjectId++;
 
 		m_PlaneGeometries.emplace_back(p);
 		return &m_PlaneGeometries.back();
 	}
 
-	TriangleMesh* Scene::AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex)
+	TriangleMesh* Scene::AddTriangleMesh()
+	{
+		m_TriangleMeshGeometries.emplace_back(std::make_unique<TriangleMesh>());
+		return m_TriangleMeshGeometries.back().get();
+	}
+
+	TriangleMesh* Scene::AddTriangleMesh(const std::string& meshFilename)
+	{
+		TriangleMesh* pMesh{ AddTriangleMesh() };
+		if (MeshFile::Load(meshFilename, *pMesh))
+			return pMesh;
+
+		m_TriangleMeshGeometries.pop_back();
+		return nullptr;
+	}
+
+	TriangleMeshInstance* Scene::AddTriangleMeshInstance(const TriangleMesh* pMesh, TriangleCullMode cullMode, unsigned char materialIndex)
 	{
-		TriangleMesh m{};
+		TriangleMeshInstance m{};
+		m.pMesh = pMesh;
 		m.cullMode = cullMode;
 		m.materialIndex = materialIndex;
+		m.objectId = m_NextObjectId++;
 
-		m_TriangleMeshGeometries.emplace_back(m);
-		return &m_TriangleMeshGeometries.back();
+		m_TriangleMeshInstances.emplace_back(m);
+		return &m_TriangleMeshInstances.back();
 	}
 
 	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
@@ -146,9 +413,9 @@ namespace dae {
 		return &m_Lights.back();
 	}
 
-	unsigned char Scene::AddMaterial(Material* pMaterial)
+	unsigned char Scene::AddMaterial(const Material& material)
 	{
-		m_Materials.push_back(pMaterial);
+		m_Materials.push_back(material);
 		return static_cast<unsigned char>(m_Materials.size() - 1);
 	}
 #pragma endregion
@@ -159,11 +426,11 @@ namespace dae {
 	{
 		//default: Material id0 >> SolidColor Material (RED)
 		constexpr unsigned char matId_Solid_Red = 0;
-		const unsigned char matId_Solid_Blue = AddMaterial(new Material_SolidColor{ colors::Blue });
+		const unsigned char matId_Solid_Blue = AddMaterial(Material::CreateSolidColor(colors::Blue));
 
-		const unsigned char matId_Solid_Yellow = AddMaterial(new Material_SolidColor{ colors::Yellow });
-		const unsigned char matId_Solid_Green = AddMaterial(new Material_SolidColor{ colors::Green });
-		const unsigned char matId_Solid_Magenta = AddMaterial(new Material_SolidColor{ colors::Magenta });
+		const unsigned char matId_Solid_Yellow = AddMaterial(Material::CreateSolidColor(colors::Yellow));
+		const unsigned char matId_Solid_Green = AddMaterial(Material::CreateSolidColor(colors::Green));
+		const unsigned char matId_Solid_Magenta = AddMaterial(Material::CreateSolidColor(colors::Magenta));
 
 		//Spheres
 		AddSphere({ -25.f, 0.f, 100.f }, 50.f, matId_Solid_Red);
@@ -187,11 +454,11 @@ namespace dae {
 
 		//default: Material id0 >> SolidColor Material (RED)
 		constexpr unsigned char matId_Solid_Red = 0;
-		const unsigned char matId_Solid_Blue = AddMaterial(new Material_SolidColor{ colors::Blue });
+		const unsigned char matId_Solid_Blue = AddMaterial(Material::CreateSolidColor(colors::Blue));
 
-		const unsigned char matId_Solid_Yellow = AddMaterial(new Material_SolidColor{ colors::Yellow });
-		const unsigned char matId_Solid_Green = AddMaterial(new Material_SolidColor{ colors::Green });
-		const unsigned char matId_Solid_Magenta = AddMaterial(new Material_SolidColor{ colors::Magenta });
+		const unsigned char matId_Solid_Yellow = AddMaterial(Material::CreateSolidColor(colors::Yellow));
+		const unsigned char matId_Solid_Green = AddMaterial(Material::CreateSolidColor(colors::Green));
+		const unsigned char matId_Solid_Magenta = AddMaterial(Material::CreateSolidColor(colors::Magenta));
 
 		//Plane
 		AddPlane({ -5.f, 0.f, 0.f }, { 1.f, 0.f,0.f }, matId_Solid_Green);
@@ -221,9 +488,9 @@ namespace dae {
 		m_Camera.UpdateFOV();
 
 		//Materials
-		const auto matLambert_Red = AddMaterial(new Material_Lambert(colors::Red, 1.f));
-		const auto matLambertPhong_Blue = AddMaterial(new Material_LambertPhong(colors::Blue, 1.f, 1.f, 60.f));
-		const auto matLambert_Yellow = AddMaterial(new Material_Lambert(colors::Yellow, 1.f));
+		const auto matLambert_Red = AddMaterial(Material::CreateLambert(colors::Red, 1.f));
+		const auto matLambertPhong_Blue = AddMaterial(Material::CreateLambertPhong(colors::Blue, 1.f, 1.f, 60.f));
+		const auto matLambert_Yellow = AddMaterial(Material::CreateLambert(colors::Yellow, 1.f));
 
 		//Spheres
 		AddSphere({ -.75f, 1.f, .0f }, 1.f, matLambert_Red);
@@ -245,14 +512,14 @@ namespace dae {
 		m_Camera.fovAngle = 45.f;
 		m_Camera.UpdateFOV();
 
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(Material::CreateCookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 1.f));
+		const auto matCT_GrayMediumMetal = AddMaterial(Material::CreateCookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(Material::CreateCookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(Material::CreateCookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(Material::CreateCookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(Material::CreateCookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ 0.49f, 0.57f, 0.57f }, 1.f));
 
 		//Plane
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f,-1.f }, matLambert_GrayBlue); // BACK
@@ -262,9 +529,9 @@ namespace dae {
 		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f,0.f }, matLambert_GrayBlue); // LEFT
 
 		// Temporary Lambert-Phong Spheres & Materials
-		//const auto matLabertPhong1 = AddMaterial(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 3.f));
-		//const auto matLabertPhong2 = AddMaterial(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 15.f));
-		//const auto matLabertPhong3 = AddMaterial(new Material_LambertPhong(colors::Blue, 0.5f, 0.5f, 50.f));
+		//const auto matLabertPhong1 = AddMaterial(Material::CreateLambertPhong(colors::Blue, 0.5f, 0.5f, 3.f));
+		//const auto matLabertPhong2 = AddMaterial(Material::CreateLambertPhong(colors::Blue, 0.5f, 0.5f, 15.f));
+		//const auto matLabertPhong3 = AddMaterial(Material::CreateLambertPhong(colors::Blue, 0.5f, 0.5f, 50.f));
 		//
 		//AddSphere(Vector3{ -1.75f, 1.f, 0.f }, .75f, matLabertPhong1);
 		//AddSphere(Vector3{ 0.f, 1.f, 0.f }, .75f, matLabertPhong2);
@@ -296,8 +563,8 @@ namespace dae {
 		//m_Camera.totalYaw = PI;
 
 		//Materials
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({0.49f, 0.57f, 0.57f}, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({0.49f, 0.57f, 0.57f}, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
 
 		//Plane
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, { 0.f, 0.f,-1.f }, matLambert_GrayBlue); // BACK
@@ -330,14 +597,11 @@ namespace dae {
 
 
 		//Triangle Mesh -- Simple Cube || Simple Object
-		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/simple_cube.obj",
-		//Utils::ParseOBJ("Resources/simple_object.obj",
-			pMesh->positions,
-			pMesh->normals,
-			pMesh->indices);
-
+		TriangleMesh* pCubeMesh = AddTriangleMesh();
+		Utils::LoadOBJ("Resources/simple_cube.obj", *pCubeMesh);
+		//Utils::LoadOBJ("Resources/simple_object.obj", *pCubeMesh);
 
+		pMesh = AddTriangleMeshInstance(pCubeMesh, TriangleCullMode::BackFaceCulling, matLambert_White);
 		pMesh->Scale({0.7f, 0.7f, 0.7f});
 		pMesh->Translate({ 0.0f, 1.f, 0.0f });
 
@@ -368,15 +632,15 @@ namespace dae {
 		m_Camera.fovAngle = 45.f;
 		m_Camera.UpdateFOV();
 
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.6f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.6f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.1f));
+		const auto matCT_GrayRoughMetal = AddMaterial(Material::CreateCookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 1.f));
+		const auto matCT_GrayMediumMetal = AddMaterial(Material::CreateCookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.6f));
+		const auto matCT_GraySmoothMetal = AddMaterial(Material::CreateCookTorrence({ 0.972f, 0.960f, 0.915f }, 1.f, 0.1f));
+		const auto matCT_GrayRoughPlastic = AddMaterial(Material::CreateCookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 1.f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(Material::CreateCookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.6f));
+		const auto matCT_GraySmoothPlastic = AddMaterial(Material::CreateCookTorrence({ 0.75f, 0.75f, 0.75f }, 0.f, 0.1f));
 
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ 0.49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
 
 		//Plane
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f,-1.f }, matLambert_GrayBlue); // BACK
@@ -396,25 +660,20 @@ namespace dae {
 		// CW Winding Order!
 		const Triangle baseTriangle = { Vector3{-0.75f, 1.5f, 0.0f}, Vector3{0.75f, 0.0f, 0.0f}, Vector3{-0.75f, 0.0f, 0.0f} };
 
-		m_Meshes[0] = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		m_Meshes[0]->AppendTriangle(baseTriangle, true);
+		// one shared triangle (+ BVH) for all three instances
+		TriangleMesh* pTriangleMesh = AddTriangleMesh();
+		pTriangleMesh->AppendTriangle(baseTriangle);
+
+		m_Meshes[0] = AddTriangleMeshInstance(pTriangleMesh, TriangleCullMode::BackFaceCulling, matLambert_White);
 		m_Meshes[0]->Translate({ -1.75f, 4.5f, 0.0f });
-		m_Meshes[0]->pBvhNodes = new BVHNode[m_Meshes[0]->indices.size()]{};
-		//m_Meshes[0]->UpdateAABB();
 		m_Meshes[0]->UpdateTransforms();
 
-		m_Meshes[1] = AddTriangleMesh(TriangleCullMode::FrontFaceCulling, matLambert_White);
-		m_Meshes[1]->AppendTriangle(baseTriangle, true);
+		m_Meshes[1] = AddTriangleMeshInstance(pTriangleMesh, TriangleCullMode::FrontFaceCulling, matLambert_White);
 		m_Meshes[1]->Translate({ 0.0f, 4.5f, 0.0f });
-		m_Meshes[1]->pBvhNodes = new BVHNode[m_Meshes[1]->indices.size()]{};
-		//m_Meshes[1]->UpdateAABB();
 		m_Meshes[1]->UpdateTransforms();
 
-		m_Meshes[2] = AddTriangleMesh(TriangleCullMode::NoCulling, matLambert_White);
-		m_Meshes[2]->AppendTriangle(baseTriangle, true);
+		m_Meshes[2] = AddTriangleMeshInstance(pTriangleMesh, TriangleCullMode::NoCulling, matLambert_White);
 		m_Meshes[2]->Translate({ 1.75f, 4.5f, 0.0f });
-		m_Meshes[2]->pBvhNodes = new BVHNode[m_Meshes[2]->indices.size()]{};
-		//m_Meshes[2]->UpdateAABB();
 		m_Meshes[2]->UpdateTransforms();
 
 
@@ -447,8 +706,8 @@ namespace dae {
 
 
 		//Materials
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ 0.49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
 
 		//Plane
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, { 0.f, 0.f,-1.f }, matLambert_GrayBlue); // BACK
@@ -459,17 +718,12 @@ namespace dae {
 
 
 		//Bunny Object
-		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/lowpoly_bunny.obj",
-			pMesh->positions,
-			pMesh->normals,
-			pMesh->indices);
-
-		pMesh->pBvhNodes = new BVHNode[pMesh->indices.size()]{};
+		TriangleMesh* pBunnyMesh = AddTriangleMesh();
+		Utils::LoadOBJ("Resources/lowpoly_bunny.obj", *pBunnyMesh);
 
+		pMesh = AddTriangleMeshInstance(pBunnyMesh, TriangleCullMode::BackFaceCulling, matLambert_White);
 		pMesh->Scale({ 2.f, 2.f, 2.f });
 
-		//pMesh->UpdateAABB();
 		pMesh->UpdateTransforms();
 
 
@@ -501,8 +755,8 @@ namespace dae {
 
 
 		//Materials
-		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ 0.49f, 0.57f, 0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		const auto matLambert_GrayBlue = AddMaterial(Material::CreateLambert({ 0.49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(Material::CreateLambert(colors::White, 1.f));
 
 		//Plane
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, { 0.f, 0.f,-1.f }, matLambert_GrayBlue); // BACK
@@ -513,17 +767,12 @@ namespace dae {
 
 
 		//Bunny Object
-		pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/Honda_S2000_LowPoly.obj",
-			pMesh->positions,
-			pMesh->normals,
-			pMesh->indices);
-
-		pMesh->pBvhNodes = new BVHNode[pMesh->indices.size()]{};
+		TriangleMesh* pCarMesh = AddTriangleMesh();
+		Utils::LoadOBJ("Resources/Honda_S2000_LowPoly.obj", *pCarMesh);
 
+		pMesh = AddTriangleMeshInstance(pCarMesh, TriangleCullMode::BackFaceCulling, matLambert_White);
 		//pMesh->Scale({ 2.f, 2.f, 2.f });
 
-		//pMesh->UpdateAABB();
 		pMesh->UpdateTransforms();
 
 
@@ -1,16 +1,18 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "Math.h"
 #include "DataTypes.h"
 #include "Camera.h"
+#include "CpuFeatures.h"
+#include "Material.h"
 
 namespace dae
 {
 	//Forward Declarations
 	class Timer;
-	class Material;
 	struct Plane;
 	struct Sphere;
 	struct Light;
@@ -34,22 +36,48 @@ namespace dae
 		}
 
 		Camera& GetCamera() { return m_Camera; }
+
+		// The ray queries are compiled for every instruction set (SceneQueries.inl), the render kernels call the copy of their own
+		template<SimdLevel Level>
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
+		template<SimdLevel Level>
 		bool DoesHit(const Ray& ray) const;
+		// Closest hit for N coherent rays at once, the hit records of lanes that missed keep didHit == false
+		template<SimdLevel Level, int N>
+		void GetClosestHitPacket(const RayPacket<N>& ray, PacketHitRecord<N>& closestHit) const;
+
+		// Rebuilds the top level BVH when objects got added, otherwise only refits it to the moved objects
+		void UpdateTopLevelBVH();
+		// changes whenever an object or light moved between two UpdateTopLevelBVH calls, lets the renderer know its history is stale
+		uint32_t GetStateVersion() const { return m_StateVersion; }
 
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
 		const std::vector<Light>& GetLights() const { return m_Lights; }
-		const std::vector<Material*> GetMaterials() const { return m_Materials; }
+		const std::vector<Material>& GetMaterials() const { return m_Materials; }
 
 	protected:
 		std::string	sceneName;
 
 		std::vector<Plane> m_PlaneGeometries{};
 		std::vector<Sphere> m_SphereGeometries{};
-		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
+		// on the heap, so the instances' pMesh stays valid when more meshes get added
+		std::vector<std::unique_ptr<TriangleMesh>> m_TriangleMeshGeometries{};
+		std::vector<TriangleMeshInstance> m_TriangleMeshInstances{};
 		std::vector<Light> m_Lights{};
-		std::vector<Material*> m_Materials{};
+		std::vector<Material> m_Materials{};
+		// handed out by the Add functions, every sphere, plane and mesh instance gets its own
+		uint32_t m_NextObjectId{};
+
+		// Top level BVH over spheres and mesh instances, planes are unbounded and stay in their own list
+		std::vector<TopLevelPrimitive> m_TopLevelPrimitives{};
+		std::vector<TopLevelBVHNode> m_TopLevelNodes{};
+		unsigned int m_TopLevelNodesUsed{};
+		float m_TopLevelBuiltSAHCost{}; // refitting moving objects grows the boxes, compared against BVHRebuildThreshold
+
+		// everything that can move, as recorded by the last UpdateStateVersion
+		std::vector<float> m_StateSnapshot{};
+		uint32_t m_StateVersion{};
 
 		// Temp (Individual Trangle Testing)
 		//std::vector<Triangle> m_Triangles{};
@@ -58,11 +86,28 @@ namespace dae
 
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
-		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		TriangleMesh* AddTriangleMesh();
+		// maps a binary mesh file (see MeshFile), nullptr if it can't be loaded
+		TriangleMesh* AddTriangleMesh(const std::string& meshFilename);
+		TriangleMeshInstance* AddTriangleMeshInstance(const TriangleMesh* pMesh, TriangleCullMode cullMode, unsigned char materialIndex = 0);
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
-		unsigned char AddMaterial(Material* pMaterial);
+		unsigned char AddMaterial(const Material& material);
+
+	private:
+		void BuildTopLevelBVH();
+		void SubdivideTopLevel(unsigned int nodeIdx, unsigned int depth);
+		void RefitTopLevelBVH();
+		float CalculateTopLevelSAHCost() const;
+		void UpdateTopLevelPrimitiveBounds(TopLevelPrimitive& primitive) const;
+		void UpdateTopLevelNodeBounds(unsigned int nodeIdx);
+		void UpdateStateVersion();
+
+		template<SimdLevel Level>
+		void IntersectTopLevelBVH(const Ray& ray, HitRecord& closestHit) const;
+		template<SimdLevel Level>
+		bool DoesHitTopLevelBVH(const Ray& ray) const;
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -145,7 +190,7 @@ namespace dae
 		void Initialize() override;
 		void Update(Timer* pTimer) override;
 	private:
-		TriangleMesh* pMesh{ nullptr };
+		TriangleMeshInstance* pMesh{ nullptr };
 	};
 
 
@@ -165,7 +210,7 @@ namespace dae
 		void Initialize() override;
 		void Update(Timer* pTimer) override;
 	private:
-		TriangleMesh* m_Meshes[3]{};
+		TriangleMeshInstance* m_Meshes[3]{};
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -184,7 +229,7 @@ namespace dae
 		void Initialize() override;
 		void Update(Timer* pTimer) override;
 	private:
-		TriangleMesh* pMesh{ nullptr };
+		TriangleMeshInstance* pMesh{ nullptr };
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -203,6 +248,6 @@ namespace dae
 		void Initialize() override;
 		//void Update(Timer* pTimer) override;
 	private:
-		TriangleMesh* pMesh{ nullptr };
+		TriangleMeshInstance* pMesh{ nullptr };
 	};
 }
@@ -0,0 +1,227 @@
+// Ray queries of the Scene, only included by the Kernels_*.cpp files (see Kernels.inl).
+// Level only tells the copies of the different instruction sets apart, the code is the same for all of them.
+#include "Scene.h"
+#include "Utils.h"
+
+namespace dae
+{
+	template<SimdLevel Level>
+	SIMD_KERNEL void Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
+	{
+		HitRecord tempHit{};
+
+		for (const Plane& currPlane : m_PlaneGeometries)
+		{
+			
+			if (GeometryUtils::HitTest_Plane(currPlane, ray, tempHit) && tempHit.t < closestHit.t)
+			{
+				closestHit = tempHit;
+			}
+		
+		}
+
+		if (!m_TopLevelNodes.empty())
+			IntersectTopLevelBVH<Level>(ray, closestHit);
+	}
+
+	template<SimdLevel Level>
+	SIMD_KERNEL bool Scene::DoesHit(const Ray& ray) const
+	{
+		for (const Plane& currPlane : m_PlaneGeometries)
+		{
+			if (GeometryUtils::HitTest_Plane(currPlane, ray))
+			{
+				return true;
+			}
+		}
+
+		if (!m_TopLevelNodes.empty())
+			return DoesHitTopLevelBVH<Level>(ray);
+
+		return false;
+	}
+
+	template<SimdLevel Level, int N>
+	SIMD_KERNEL void Scene::GetClosestHitPacket(const RayPacket<N>& ray, PacketHitRecord<N>& closestHit) const
+	{
+		using vfloat = simd::vfloat<N>;
+		const vfloat allLanes{ vfloat::AllBits() };
+
+		for (const Plane& currPlane : m_PlaneGeometries)
+		{
+			GeometryUtils::HitTest_Plane_Packet(currPlane, ray, closestHit, allLanes);
+		}
+
+		if (m_TopLevelNodes.empty())
+			return;
+
+		// same traversal as IntersectTopLevelBVH, the whole packet walks the tree together
+		GeometryUtils::PacketStackEntry<N> stack[BVHStackSize];
+		int stackSize{ 0 };
+
+		vfloat rootEntryT{};
+		const vfloat rootMask{ GeometryUtils::IntersectAABB_Packet(ray, m_TopLevelNodes[0].minAABB, m_TopLevelNodes[0].maxAABB, closestHit.t, rootEntryT) };
+		if (MoveMask(rootMask) == 0)
+			return;
+		stack[stackSize++] = { 0, rootMask, rootEntryT };
+
+		while (stackSize > 0)
+		{
+			const GeometryUtils::PacketStackEntry<N> entry{ stack[--stackSize] };
+
+			const vfloat nodeMask{ entry.mask & (entry.entryT < closestHit.t) };
+			if (MoveMask(nodeMask) == 0)
+				continue;
+
+			const TopLevelBVHNode& node = m_TopLevelNodes[entry.nodeIdx];
+			if (node.IsLeaf() == false)
+			{
+				GeometryUtils::PushChildren_Packet(m_TopLevelNodes.data(), node.leftNode, ray, nodeMask, closestHit.t, stack, stackSize);
+				continue;
+			}
+
+			for (unsigned int i{ 0 }; i < node.primCount; ++i)
+			{
+				const TopLevelPrimitive& primitive{ m_TopLevelPrimitives[node.firstPrimIdx + i] };
+				switch (primitive.type)
+				{
+				case TopLevelPrimitiveType::Sphere:
+					GeometryUtils::HitTest_Sphere_Packet(m_SphereGeometries[primitive.index], ray, closestHit, nodeMask);
+					break;
+				case TopLevelPrimitiveType::TriangleMeshInstance:
+					GeometryUtils::HitTest_TriangleMesh_Packet(m_TriangleMeshInstances[primitive.index], ray, closestHit, nodeMask);
+					break;
+				}
+			}
+		}
+	}
+
+	template<SimdLevel Level>
+	void Scene::IntersectTopLevelBVH(const Ray& ray, HitRecord& closestHit) const
+	{
+		// the ray gets cut off at the closest hit so far (planes included), nodes and meshes behind it are skipped
+		Ray closestRay{ ray };
+		closestRay.max = std::min(ray.max, closestHit.t);
+
+		float rootEntryT{};
+		if (!GeometryUtils::IntersectAABB(closestRay, m_TopLevelNodes[0].minAABB, m_TopLevelNodes[0].maxAABB, rootEntryT))
+			return;
+
+		// node + the distance the ray enters it
+		struct StackEntry
+		{
+			unsigned int nodeIdx;
+			float entryT;
+		};
+		StackEntry stack[BVHStackSize];
+		int stackSize{ 0 };
+		stack[stackSize++] = { 0, rootEntryT };
+
+		HitRecord tempHit{};
+		while (stackSize > 0)
+		{
+			const StackEntry entry{ stack[--stackSize] };
+			if (entry.entryT > closestRay.max)
+				continue;
+
+			const TopLevelBVHNode& node = m_TopLevelNodes[entry.nodeIdx];
+			if (node.IsLeaf() == false)
+			{
+				// Slabtest both children, the nearest one goes on top of the stack
+				float leftEntryT{};
+				float rightEntryT{};
+				const bool hitLeft{ GeometryUtils::IntersectAABB(closestRay, m_TopLevelNodes[node.leftNode].minAABB, m_TopLevelNodes[node.leftNode].maxAABB, leftEntryT) };
+				const bool hitRight{ GeometryUtils::IntersectAABB(closestRay, m_TopLevelNodes[node.leftNode + 1].minAABB, m_TopLevelNodes[node.leftNode + 1].maxAABB, rightEntryT) };
+
+				if (hitLeft && hitRight)
+				{
+					if (leftEntryT <= rightEntryT)
+					{
+						stack[stackSize++] = { node.leftNode + 1, rightEntryT };
+						stack[stackSize++] = { node.leftNode, leftEntryT };
+					}
+					else
+					{
+						stack[stackSize++] = { node.leftNode, leftEntryT };
+						stack[stackSize++] = { node.leftNode + 1, rightEntryT };
+					}
+				}
+				else if (hitLeft)
+				{
+					stack[stackSize++] = { node.leftNode, leftEntryT };
+				}
+				else if (hitRight)
+				{
+					stack[stackSize++] = { node.leftNode + 1, rightEntryT };
+				}
+				continue;
+			}
+
+			for (unsigned int i{ 0 }; i < node.primCount; ++i)
+			{
+				const TopLevelPrimitive& primitive{ m_TopLevelPrimitives[node.firstPrimIdx + i] };
+				switch (primitive.type)
+				{
+				case TopLevelPrimitiveType::Sphere:
+					if (GeometryUtils::HitTest_Sphere(m_SphereGeometries[primitive.index], closestRay, tempHit) && tempHit.t < closestHit.t)
+					{
+						closestHit = tempHit;
+						closestHit.normal.Normalize();
+						closestRay.max = closestHit.t;
+					}
+					break;
+				case TopLevelPrimitiveType::TriangleMeshInstance:
+					if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshInstances[primitive.index], closestRay, tempHit) && tempHit.t < closestHit.t)
+					{
+						closestHit = tempHit;
+						closestRay.max = closestHit.t;
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	template<SimdLevel Level>
+	bool Scene::DoesHitTopLevelBVH(const Ray& ray) const
+	{
+		// any hit will do, so no ordering, just stop at the first occluder
+		unsigned int stack[BVHStackSize];
+		int stackSize{ 0 };
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			const TopLevelBVHNode& node = m_TopLevelNodes[stack[--stackSize]];
+
+			// Slabtest
+			if (!GeometryUtils::IntersectAABB(ray, node.minAABB, node.maxAABB))
+				continue;
+
+			if (node.IsLeaf() == false)
+			{
+				stack[stackSize++] = node.leftNode + 1;
+				stack[stackSize++] = node.leftNode;
+				continue;
+			}
+
+			for (unsigned int i{ 0 }; i < node.primCount; ++i)
+			{
+				const TopLevelPrimitive& primitive{ m_TopLevelPrimitives[node.firstPrimIdx + i] };
+				switch (primitive.type)
+				{
+				case TopLevelPrimitiveType::Sphere:
+					if (GeometryUtils::HitTest_Sphere(m_SphereGeometries[primitive.index], ray))
+						return true;
+					break;
+				case TopLevelPrimitiveType::TriangleMeshInstance:
+					if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshInstances[primitive.index], ray))
+						return true;
+					break;
+				}
+			}
+		}
+
+		return false;
+	}
+}
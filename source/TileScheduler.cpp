@@ -0,0 +1,172 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+
+using namespace dae;
+
+TileScheduler::TileScheduler(uint32_t numWorkers)
+{
+	StartWorkers(numWorkers);
+}
+
+TileScheduler::~TileScheduler()
+{
+	StopWorkers();
+}
+
+void TileScheduler::SetWorkerCount(uint32_t numWorkers)
+{
+	StopWorkers();
+	StartWorkers(numWorkers);
+}
+
+void TileScheduler::StartWorkers(uint32_t numWorkers)
+{
+	if (numWorkers == 0)
+		numWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+
+	m_IsStopping = false;
+
+	m_WorkQueues.clear();
+	m_WorkQueues.reserve(numWorkers);
+	for (uint32_t i{ 0 }; i < numWorkers; ++i)
+	{
+		m_WorkQueues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	// worker 0 is the thread calling Run, so only spawn the others
+	m_Workers.reserve(numWorkers - 1);
+	for (uint32_t i{ 1 }; i < numWorkers; ++i)
+	{
+		m_Workers.emplace_back(&TileScheduler::WorkerLoop, this, i);
+	}
+}
+
+void TileScheduler::StopWorkers()
+{
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_StartCondition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+	m_Workers.clear();
+}
+
+void TileScheduler::Run(uint32_t numTiles, const std::function<void(uint32_t)>& task)
+{
+	if (numTiles == 0)
+		return;
+
+	// publish the task before any tile becomes visible, a worker still stealing from the previous frame may pick one up
+	m_pTask = &task;
+	m_RemainingTiles.store(numTiles);
+
+	// hand out contiguous blocks, neighbouring tiles share more cache lines (BVH nodes, triangles...)
+	const uint32_t numWorkers{ GetWorkerCount() };
+	const uint32_t tilesPerWorker{ numTiles / numWorkers };
+	uint32_t numUnassignedTiles{ numTiles % numWorkers };
+	uint32_t currTileIdx{ 0 };
+
+	for (uint32_t workerIdx{ 0 }; workerIdx < numWorkers; ++workerIdx)
+	{
+		uint32_t blockSize{ tilesPerWorker };
+		if (numUnassignedTiles > 0)
+		{
+			++blockSize;
+			--numUnassignedTiles;
+		}
+
+		WorkQueue& queue{ *m_WorkQueues[workerIdx] };
+		std::lock_guard lock{ queue.mutex };
+		for (uint32_t i{ 0 }; i < blockSize; ++i)
+		{
+			queue.tiles.push_back(currTileIdx++);
+		}
+	}
+
+	// wake up the workers
+	{
+		std::lock_guard lock{ m_Mutex };
+		++m_Generation;
+	}
+	m_StartCondition.notify_all();
+
+	// the calling thread helps out as worker 0
+	ProcessTiles(0);
+
+	// wait for the tiles other workers are still busy with
+	std::unique_lock lock{ m_Mutex };
+	m_DoneCondition.wait(lock, [this] { return m_RemainingTiles.load() == 0; });
+	m_pTask = nullptr;
+}
+
+void TileScheduler::WorkerLoop(uint32_t workerIdx)
+{
+	uint64_t lastGeneration{ 0 };
+	while (true)
+	{
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_StartCondition.wait(lock, [&] { return m_IsStopping || m_Generation != lastGeneration; });
+			if (m_IsStopping)
+				return;
+
+			lastGeneration = m_Generation;
+		}
+
+		ProcessTiles(workerIdx);
+	}
+}
+
+void TileScheduler::ProcessTiles(uint32_t workerIdx)
+{
+	uint32_t tileIdx{};
+	while (PopTile(workerIdx, tileIdx) || StealTile(workerIdx, tileIdx))
+	{
+		(*m_pTask)(tileIdx);
+
+		// last tile of the frame -> let Run return
+		if (m_RemainingTiles.fetch_sub(1) == 1)
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_DoneCondition.notify_all();
+		}
+	}
+}
+
+bool TileScheduler::PopTile(uint32_t workerIdx, uint32_t& tileIdx)
+{
+	WorkQueue& queue{ *m_WorkQueues[workerIdx] };
+	std::lock_guard lock{ queue.mutex };
+	if (queue.tiles.empty())
+		return false;
+
+	tileIdx = queue.tiles.front();
+	queue.tiles.pop_front();
+	return true;
+}
+
+bool TileScheduler::StealTile(uint32_t workerIdx, uint32_t& tileIdx)
+{
+	// start at the next worker so all thieves don't hammer the same queue
+	const uint32_t numWorkers{ GetWorkerCount() };
+	for (uint32_t i{ 1 }; i < numWorkers; ++i)
+	{
+		WorkQueue& victim{ *m_WorkQueues[(workerIdx + i) % numWorkers] };
+		std::lock_guard lock{ victim.mutex };
+		if (victim.tiles.empty())
+			continue;
+
+		// steal from the back, the owner works from the front
+		tileIdx = victim.tiles.back();
+		victim.tiles.pop_back();
+		return true;
+	}
+
+	return false;
+}
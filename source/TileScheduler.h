@@ -0,0 +1,72 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Small persistent work-stealing thread pool.
+	 * Every worker owns a queue of tile indices, it pops work from the front of its own queue
+	 * and steals from the back of the other queues once it runs dry.
+	 * The calling thread joins in as worker 0, so nothing sits idle while waiting for the frame.
+	 */
+	class TileScheduler final
+	{
+	public:
+		// numWorkers == 0 -> use std::thread::hardware_concurrency()
+		explicit TileScheduler(uint32_t numWorkers = 0);
+		~TileScheduler();
+
+		TileScheduler(const TileScheduler&) = delete;
+		TileScheduler(TileScheduler&&) noexcept = delete;
+		TileScheduler& operator=(const TileScheduler&) = delete;
+		TileScheduler& operator=(TileScheduler&&) noexcept = delete;
+
+		/**
+		 * \brief Runs task(tileIdx) for every tile in [0, numTiles) and blocks until all of them are done
+		 * \param numTiles amount of tiles to process
+		 * \param task function that gets called once per tile, from any worker
+		 */
+		void Run(uint32_t numTiles, const std::function<void(uint32_t)>& task);
+
+		void SetWorkerCount(uint32_t numWorkers);
+		uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_WorkQueues.size()); }
+
+	private:
+		struct WorkQueue
+		{
+			std::mutex mutex{};
+			std::deque<uint32_t> tiles{};
+		};
+
+		void StartWorkers(uint32_t numWorkers);
+		void StopWorkers();
+
+		void WorkerLoop(uint32_t workerIdx);
+		void ProcessTiles(uint32_t workerIdx);
+
+		bool PopTile(uint32_t workerIdx, uint32_t& tileIdx);
+		bool StealTile(uint32_t workerIdx, uint32_t& tileIdx);
+
+		std::vector<std::unique_ptr<WorkQueue>> m_WorkQueues{};
+		std::vector<std::thread> m_Workers{};
+
+		const std::function<void(uint32_t)>* m_pTask{};
+		std::atomic<uint32_t> m_RemainingTiles{ 0 };
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_StartCondition{};
+		std::condition_variable m_DoneCondition{};
+		uint64_t m_Generation{ 0 };
+		bool m_IsStopping{ false };
+	};
+}
@@ -1,10 +1,9 @@
 #pragma once
 #include <cassert>
-#include <fstream>
 #include "Math.h"
 #include "DataTypes.h"
-
-#define MAYA_IMPORT
+#include "MeshCache.h"
+#include "ObjParser.h"
 
 namespace dae
 {
@@ -12,7 +11,7 @@ namespace dae
 	{
 #pragma region Sphere HitTest
 		//SPHERE HIT-TESTS
-		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord)
 		{
 			//  ----------- NEW CODE -------------------------------------------------
 			// using the info from fxMath - week 01: Ray sphere intersection 2D
@@ -36,38 +35,44 @@ namespace dae
 			if (t <= ray.min || t > ray.max)
 				return false;
 
-			if (ignoreHitRecord) return true;
-
 			//const Vector3 intersectPoint{ ray.origin + t * ray.direction };
 			hitRecord.t = t;
 			hitRecord.origin = ray.origin + t * ray.direction;
 			hitRecord.normal = (hitRecord.origin - sphere.origin);
 			hitRecord.materialIndex = sphere.materialIndex;
+			hitRecord.objectId = sphere.objectId;
+			hitRecord.primitiveIndex = 0;
 			hitRecord.didHit = true;
 			return true;
 
 		}
 
+		// Occlusion test (shadow rays), only answers if something is in the way
 		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_Sphere(sphere, ray, temp, true);
+			const Vector3 tc{ sphere.origin - ray.origin };
+			const float dp{ Vector3::Dot(tc, ray.direction) };
+			const float odSqr{ tc.SqrMagnitude() - (dp * dp) };
+			if (odSqr > (sphere.radius * sphere.radius))
+				return false;
+
+			const float t{ dp - sqrtf((sphere.radius * sphere.radius) - odSqr) };
+			return t > ray.min && t <= ray.max;
 		}
 #pragma endregion
 #pragma region Plane HitTest
 		//PLANE HIT-TESTS
-		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord)
 		{
 			float t{ Vector3::Dot((plane.origin - ray.origin), plane.normal) / Vector3::Dot(ray.direction, plane.normal) };
 			if (t > ray.min && t <= ray.max)
 			{
-				if (ignoreHitRecord)
-					return true;
-
 				hitRecord.t = t;
 				hitRecord.origin = ray.origin + (ray.direction * t);
 				hitRecord.normal = plane.normal;
 				hitRecord.materialIndex = plane.materialIndex;
+				hitRecord.objectId = plane.objectId;
+				hitRecord.primitiveIndex = 0;
 				hitRecord.didHit = true;
 			}
 
@@ -75,40 +80,25 @@ namespace dae
 			return hitRecord.didHit;
 		}
 
+		// Occlusion test (shadow rays)
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_Plane(plane, ray, temp, true);
+			const float t{ Vector3::Dot((plane.origin - ray.origin), plane.normal) / Vector3::Dot(ray.direction, plane.normal) };
+			return t > ray.min && t <= ray.max;
 		}
 #pragma endregion
 #pragma region Triangle HitTest
 		//TRIANGLE HIT-TESTS
-		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord)
 		{
 			// check if viewray is intersecting with the triangle
 			const float dotProductNormalViewray = Vector3::Dot(triangle.normal, ray.direction);
 			if (dotProductNormalViewray == 0)
 				return false;
-			
-
-			// switch the cullmode because of shadows
-			TriangleCullMode currentCullMode = triangle.cullMode;
-			if (ignoreHitRecord)
-			{
-				switch (currentCullMode)
-				{
-				case TriangleCullMode::FrontFaceCulling:
-					currentCullMode = TriangleCullMode::BackFaceCulling;
-					break;
-				case TriangleCullMode::BackFaceCulling:
-					currentCullMode = TriangleCullMode::FrontFaceCulling;
-					break;
-				}
-			}
 
 
 			// return depending on the culling mode situations
-			switch (currentCullMode)
+			switch (triangle.cullMode)
 			{
 			case TriangleCullMode::FrontFaceCulling:
 				if (dotProductNormalViewray < 0)
@@ -118,6 +108,8 @@ namespace dae
 				if (dotProductNormalViewray > 0)
 					return false;
 				break;
+			case TriangleCullMode::NoCulling:
+				break;
 			}
 
 			//--------------NEW CODE------------------------------------------------------------------
@@ -152,9 +144,6 @@ namespace dae
 			if (rayT < ray.min || rayT >= ray.max)
 				return false;
 
-			if (ignoreHitRecord)
-				return true;
-
 			// if we get here, time to fill in the hitrecord and return true
 			hitRecord.t = rayT;
 			hitRecord.origin = ray.origin + (ray.direction * rayT);
@@ -169,15 +158,61 @@ namespace dae
 
 		}
 
+		// Occlusion test (shadow rays), takes the vertices directly so the mesh traversal doesn't need to build a Triangle
+		inline bool HitTest_Triangle(const Vector3& v0, const Vector3& v1, const Vector3& v2, const Vector3& normal, TriangleCullMode cullMode, const Ray& ray)
+		{
+			const float dotProductNormalViewray{ Vector3::Dot(normal, ray.direction) };
+			if (dotProductNormalViewray == 0)
+				return false;
+
+			// shadow rays travel from the surface to the light, so the culling is flipped
+			switch (cullMode)
+			{
+			case TriangleCullMode::FrontFaceCulling:
+				if (dotProductNormalViewray > 0)
+					return false;
+				break;
+			case TriangleCullMode::BackFaceCulling:
+				if (dotProductNormalViewray < 0)
+					return false;
+				break;
+			case TriangleCullMode::NoCulling:
+				break;
+			}
+
+			const Vector3 edge1{ v1 - v0 };
+			const Vector3 edge2{ v2 - v0 };
+			const Vector3 cross_rayDir_edge2{ Vector3::Cross(ray.direction, edge2) };
+
+			const float det{ Vector3::Dot(edge1, cross_rayDir_edge2) };
+			if (det > -FLT_EPSILON && det < FLT_EPSILON)
+				return false;
+
+			const float inv_det{ 1.0f / det };
+
+			const Vector3 orig_minus_vert0{ ray.origin - v0 };
+			const float baryU{ Vector3::Dot(orig_minus_vert0, cross_rayDir_edge2) * inv_det };
+			if (baryU < 0.0f || baryU > 1.0f)
+				return false;
+
+			const Vector3 cross_oriMinusVert0_edge1{ Vector3::Cross(orig_minus_vert0, edge1) };
+			const float baryV{ Vector3::Dot(ray.direction, cross_oriMinusVert0_edge1) * inv_det };
+			if (baryV < 0.0f || baryU + baryV > 1.0f)
+				return false;
+
+			const float rayT{ Vector3::Dot(edge2, cross_oriMinusVert0_edge1) * inv_det };
+			return rayT >= ray.min && rayT < ray.max;
+		}
+
 		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_Triangle(triangle, ray, temp, true);
+			return HitTest_Triangle(triangle.v0, triangle.v1, triangle.v2, triangle.normal, triangle.cullMode, ray);
 		}
 #pragma endregion
 #pragma region TriangeMesh HitTest
 
-		inline bool IntersectAABB(const Ray& ray, const Vector3& minAABB, const Vector3& maxAABB)
+		// entryT -> distance along the ray where it enters the box, used to visit the nearest node first
+		inline bool IntersectAABB(const Ray& ray, const Vector3& minAABB, const Vector3& maxAABB, float& entryT)
 		{
 			// const Vector3 inversedDirection{ 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z }; -> more fps?
 			// old -> / ray.direction...
@@ -200,74 +235,622 @@ namespace dae
 			tmin = std::max(tmin, std::min(tz1, tz2));
 			tmax = std::min(tmax, std::max(tz1, tz2));
 
-			return tmax > 0 && tmax >= tmin;
+			entryT = tmin;
+
+			// boxes starting past ray.max (closest hit so far, light distance for shadow rays) can't hold anything useful
+			return tmax > 0 && tmax >= tmin && tmin <= ray.max;
 		}
 
-		inline void IntersectBVH(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool& hasHit, HitRecord& curClosestHit, unsigned int bvhNodeIdx, bool ignoreHitRecord)
+		inline bool IntersectAABB(const Ray& ray, const Vector3& minAABB, const Vector3& maxAABB)
 		{
-			BVHNode& node = mesh.pBvhNodes[bvhNodeIdx];
+			float entryT{};
+			return IntersectAABB(ray, minAABB, maxAABB, entryT);
+		}
 
-			// Slabtest
-			if (!IntersectAABB(ray, node.minAABB, node.maxAABB)) return;
+		// Slabtest of one ray against all children of a wide node, returns one bit per child that got hit before maxT
+		inline int IntersectWideBVHNode(const WideBVHNode& node, const simd::vfloat<WideBVHWidth> (&origin)[3], const simd::vfloat<WideBVHWidth> (&inverseDirection)[3],
+			float maxT, simd::vfloat<WideBVHWidth>& entryT)
+		{
+			using vfloat = simd::vfloat<WideBVHWidth>;
 
-			if (node.IsLeaf() == false) // branch prediction -> it is more likely that a node will not be leaf
-			{
-				IntersectBVH(mesh, ray, hitRecord, hasHit, curClosestHit, node.leftNode, ignoreHitRecord);
-				IntersectBVH(mesh, ray, hitRecord, hasHit, curClosestHit, node.leftNode + 1, ignoreHitRecord);
+			const vfloat tx1{ (vfloat::Load(node.minX) - origin[0]) * inverseDirection[0] };
+			const vfloat tx2{ (vfloat::Load(node.maxX) - origin[0]) * inverseDirection[0] };
+			vfloat tmin{ Min(tx1, tx2) };
+			vfloat tmax{ Max(tx1, tx2) };
 
+			const vfloat ty1{ (vfloat::Load(node.minY) - origin[1]) * inverseDirection[1] };
+			const vfloat ty2{ (vfloat::Load(node.maxY) - origin[1]) * inverseDirection[1] };
+			tmin = Max(tmin, Min(ty1, ty2));
+			tmax = Min(tmax, Max(ty1, ty2));
+
+			const vfloat tz1{ (vfloat::Load(node.minZ) - origin[2]) * inverseDirection[2] };
+			const vfloat tz2{ (vfloat::Load(node.maxZ) - origin[2]) * inverseDirection[2] };
+			tmin = Max(tmin, Min(tz1, tz2));
+			tmax = Min(tmax, Max(tz1, tz2));
+
+			entryT = tmin;
+
+			const vfloat hitMask{ (tmax > vfloat::Zero()) & (tmax >= tmin) & (tmin < vfloat{ maxT }) };
+			// the unused child slots hold garbage bounds
+			return MoveMask(hitMask) & ((1 << node.childCount) - 1);
+		}
+
+		// Moller-Trumbore for one ray against up to WideBVHWidth consecutive leaf triangles, returns one bit per triangle hit in [minT, maxT)
+		// isShadowRay flips the culling, same as the single triangle occlusion test
+		inline int HitTest_LeafTriangles(const LeafTriangles& triangles, unsigned int firstTriangle, unsigned int triangleCount, TriangleCullMode cullMode, bool isShadowRay,
+			const simd::vfloat<WideBVHWidth> (&origin)[3], const simd::vfloat<WideBVHWidth> (&direction)[3], float minT, float maxT, simd::vfloat<WideBVHWidth>& rayT)
+		{
+			using vfloat = simd::vfloat<WideBVHWidth>;
+			const vfloat zero{ vfloat::Zero() };
+
+			const vfloat dotNormalDirection{ vfloat::Load(&triangles.normalX[firstTriangle]) * direction[0]
+				+ vfloat::Load(&triangles.normalY[firstTriangle]) * direction[1] + vfloat::Load(&triangles.normalZ[firstTriangle]) * direction[2] };
+
+			vfloat mask{ (dotNormalDirection < zero) | (dotNormalDirection > zero) };
+			switch (cullMode)
+			{
+			case TriangleCullMode::FrontFaceCulling:
+				mask = mask & (isShadowRay ? dotNormalDirection <= zero : dotNormalDirection >= zero);
+				break;
+			case TriangleCullMode::BackFaceCulling:
+				mask = mask & (isShadowRay ? dotNormalDirection >= zero : dotNormalDirection <= zero);
+				break;
+			case TriangleCullMode::NoCulling:
+				break;
 			}
-			else
+
+			const vfloat edge1X{ vfloat::Load(&triangles.edge1X[firstTriangle]) };
+			const vfloat edge1Y{ vfloat::Load(&triangles.edge1Y[firstTriangle]) };
+			const vfloat edge1Z{ vfloat::Load(&triangles.edge1Z[firstTriangle]) };
+			const vfloat edge2X{ vfloat::Load(&triangles.edge2X[firstTriangle]) };
+			const vfloat edge2Y{ vfloat::Load(&triangles.edge2Y[firstTriangle]) };
+			const vfloat edge2Z{ vfloat::Load(&triangles.edge2Z[firstTriangle]) };
+
+			// cross(direction, edge2)
+			const vfloat pX{ direction[1] * edge2Z - direction[2] * edge2Y };
+			const vfloat pY{ direction[2] * edge2X - direction[0] * edge2Z };
+			const vfloat pZ{ direction[0] * edge2Y - direction[1] * edge2X };
+
+			const vfloat det{ edge1X * pX + edge1Y * pY + edge1Z * pZ };
+			const vfloat epsilon{ FLT_EPSILON };
+			mask = mask & ((det <= -epsilon) | (det >= epsilon));
+
+			const vfloat invDet{ vfloat{ 1.f } / det };
+
+			const vfloat sX{ origin[0] - vfloat::Load(&triangles.v0X[firstTriangle]) };
+			const vfloat sY{ origin[1] - vfloat::Load(&triangles.v0Y[firstTriangle]) };
+			const vfloat sZ{ origin[2] - vfloat::Load(&triangles.v0Z[firstTriangle]) };
+
+			const vfloat baryU{ (sX * pX + sY * pY + sZ * pZ) * invDet };
+			mask = mask & (baryU >= zero) & (baryU <= vfloat{ 1.f });
+
+			// cross(s, edge1)
+			const vfloat qX{ sY * edge1Z - sZ * edge1Y };
+			const vfloat qY{ sZ * edge1X - sX * edge1Z };
+			const vfloat qZ{ sX * edge1Y - sY * edge1X };
+
+			const vfloat baryV{ (direction[0] * qX + direction[1] * qY + direction[2] * qZ) * invDet };
+			mask = mask & (baryV >= zero) & (baryU + baryV <= vfloat{ 1.f });
+
+			rayT = (edge2X * qX + edge2Y * qY + edge2Z * qZ) * invDet;
+			mask = mask & (rayT >= vfloat{ minT }) & (rayT < vfloat{ maxT });
+
+			// the lanes past the end of the leaf belong to the next leaf (or the padding)
+			return MoveMask(mask) & ((1 << triangleCount) - 1);
+		}
+
+		inline bool IntersectBVH(const TriangleMeshInstance& instance, const Ray& ray, HitRecord& hitRecord)
+		{
+			using vfloat = simd::vfloat<WideBVHWidth>;
+
+			const TriangleMesh& mesh = *instance.pMesh;
+			if (mesh.wideBvhNodeView.empty())
+				return false;
+
+			const vfloat origin[3]{ vfloat{ ray.origin.x }, vfloat{ ray.origin.y }, vfloat{ ray.origin.z } };
+			const vfloat direction[3]{ vfloat{ ray.direction.x }, vfloat{ ray.direction.y }, vfloat{ ray.direction.z } };
+			const vfloat inverseDirection[3]{ vfloat{ ray.inverseDirection.x }, vfloat{ ray.inverseDirection.y }, vfloat{ ray.inverseDirection.z } };
+
+			// every hit shortens the ray, so further triangles + boxes behind the closest hit get skipped
+			float closestT{ ray.max };
+			bool hasHit{};
+
+			// node + the distance the ray enters it, so nodes can be dropped once something closer got hit
+			struct StackEntry
+			{
+				unsigned int nodeIdx;
+				float entryT;
+			};
+			StackEntry stack[WideBVHStackSize];
+			int stackSize{ 0 };
+			stack[stackSize++] = { 0, -FLT_MAX };
+
+			while (stackSize > 0)
 			{
-				
-				// Create temp triangle
-				Triangle triangle{};
-				triangle.cullMode = mesh.cullMode;
-				triangle.materialIndex = mesh.materialIndex;
-
-				// For each triangle
-				for (int i{}; i < static_cast<int>(node.triCount); i += 3)
+				const StackEntry entry{ stack[--stackSize] };
+				if (entry.entryT >= closestT)
+					continue;
+
+				const WideBVHNode& node = mesh.wideBvhNodeView[entry.nodeIdx];
+
+				vfloat entryT{};
+				int hitMask{ IntersectWideBVHNode(node, origin, inverseDirection, closestT, entryT) };
+				if (hitMask == 0)
+					continue;
+
+				// sort the hit children near to far (insertion sort, there are at most WideBVHWidth of them)
+				alignas(sizeof(float) * WideBVHWidth) float childEntryT[WideBVHWidth];
+				entryT.Store(childEntryT);
+
+				int order[WideBVHWidth];
+				int hitCount{ 0 };
+				while (hitMask != 0)
 				{
-					// Set the position and normal of the current triangle to the triangle object
-					triangle.v0 = mesh.transformedPositions[mesh.indices[node.firstTriIdx + i]];
-					triangle.v1 = mesh.transformedPositions[mesh.indices[node.firstTriIdx + i + 1]];
-					triangle.v2 = mesh.transformedPositions[mesh.indices[node.firstTriIdx + i + 2]];
-					triangle.normal = mesh.transformedNormals[(node.firstTriIdx + i) / 3];
-
-					// If the ray hits a triangle in the mesh, check if it is closer then the previous hit triangle
-					if (HitTest_Triangle(triangle, ray, curClosestHit, ignoreHitRecord))
+					const int lane{ simd::LowestLane(hitMask) };
+					hitMask &= hitMask - 1;
+
+					int i{ hitCount++ };
+					for (; i > 0 && childEntryT[order[i - 1]] > childEntryT[lane]; --i)
 					{
-						hasHit = true;
+						order[i] = order[i - 1];
+					}
+					order[i] = lane;
+				}
 
-						if (ignoreHitRecord)
-							return;
+				// leaves right away (nearest first), inner nodes go on the stack far to near so the nearest gets popped next
+				for (int i{ 0 }; i < hitCount; ++i)
+				{
+					const int lane{ order[i] };
+					if (node.triCount[lane] == 0 || childEntryT[lane] >= closestT)
+						continue;
 
-						// Check if the current hit is closer then the previous hit
-						if (hitRecord.t > curClosestHit.t)
+					const unsigned int firstTriangle{ node.child[lane] / 3 };
+					const unsigned int triangleCount{ node.triCount[lane] / 3 };
+					for (unsigned int j{ 0 }; j < triangleCount; j += WideBVHWidth)
+					{
+						vfloat rayT{};
+						int triangleMask{ HitTest_LeafTriangles(mesh.leafTriangles, firstTriangle + j, std::min(triangleCount - j, static_cast<unsigned int>(WideBVHWidth)),
+							instance.cullMode, false, origin, direction, ray.min, closestT, rayT) };
+						if (triangleMask == 0)
+							continue;
+
+						// the ray is cut off at the closest hit, so every hit here is closer than the previous one
+						int closestTriangle{ -1 };
+						while (triangleMask != 0)
 						{
-							hitRecord = curClosestHit;
+							const int triangleLane{ simd::LowestLane(triangleMask) };
+							triangleMask &= triangleMask - 1;
+
+							if (rayT[triangleLane] < closestT)
+							{
+								closestT = rayT[triangleLane];
+								closestTriangle = triangleLane;
+							}
 						}
+
+						if (closestTriangle == -1)
+							continue;
+
+						hasHit = true;
+						hitRecord.t = closestT;
+						hitRecord.origin = ray.origin + (ray.direction * closestT);
+						hitRecord.normal = mesh.normalView[firstTriangle + j + closestTriangle];
+						hitRecord.materialIndex = instance.materialIndex;
+						hitRecord.objectId = instance.objectId;
+						hitRecord.primitiveIndex = firstTriangle + j + closestTriangle;
+						hitRecord.didHit = true;
 					}
 				}
+
+				for (int i{ hitCount - 1 }; i >= 0; --i)
+				{
+					const int lane{ order[i] };
+					if (node.triCount[lane] != 0)
+						continue;
+
+					stack[stackSize++] = { node.child[lane], childEntryT[lane] };
+				}
 			}
+
+			return hasHit;
 		}
 
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		// Any hit traversal, no ordering and no hit data, stops at the first triangle in the way
+		inline bool DoesHitBVH(const TriangleMeshInstance& instance, const Ray& ray)
 		{
-			HitRecord tempHit{};
-			bool hasHit{};
+			using vfloat = simd::vfloat<WideBVHWidth>;
+
+			const TriangleMesh& mesh = *instance.pMesh;
+			if (mesh.wideBvhNodeView.empty())
+				return false;
+
+			const vfloat origin[3]{ vfloat{ ray.origin.x }, vfloat{ ray.origin.y }, vfloat{ ray.origin.z } };
+			const vfloat direction[3]{ vfloat{ ray.direction.x }, vfloat{ ray.direction.y }, vfloat{ ray.direction.z } };
+			const vfloat inverseDirection[3]{ vfloat{ ray.inverseDirection.x }, vfloat{ ray.inverseDirection.y }, vfloat{ ray.inverseDirection.z } };
+
+			unsigned int stack[WideBVHStackSize];
+			int stackSize{ 0 };
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const WideBVHNode& node = mesh.wideBvhNodeView[stack[--stackSize]];
+
+				vfloat entryT{};
+				int hitMask{ IntersectWideBVHNode(node, origin, inverseDirection, ray.max, entryT) };
+				while (hitMask != 0)
+				{
+					const int lane{ simd::LowestLane(hitMask) };
+					hitMask &= hitMask - 1;
+
+					if (node.triCount[lane] == 0)
+					{
+						stack[stackSize++] = node.child[lane];
+						continue;
+					}
+
+					const unsigned int firstTriangle{ node.child[lane] / 3 };
+					const unsigned int triangleCount{ node.triCount[lane] / 3 };
+					for (unsigned int j{ 0 }; j < triangleCount; j += WideBVHWidth)
+					{
+						vfloat rayT{};
+						if (HitTest_LeafTriangles(mesh.leafTriangles, firstTriangle + j, std::min(triangleCount - j, static_cast<unsigned int>(WideBVHWidth)),
+							instance.cullMode, true, origin, direction, ray.min, ray.max, rayT) != 0)
+							return true;
+					}
+				}
+			}
+
+			return false;
+		}
+
+		inline bool HitTest_TriangleMesh(const TriangleMeshInstance& instance, const Ray& ray, HitRecord& hitRecord)
+		{
+			// Move the ray into object space, the direction is not normalized so t stays the same in both spaces
+			const Vector3 objectDirection{ instance.worldToObject.TransformVector(ray.direction) };
+			const Ray objectRay{ instance.worldToObject.TransformPoint(ray.origin), objectDirection,
+				{ 1.0f / objectDirection.x, 1.0f / objectDirection.y, 1.0f / objectDirection.z }, ray.min, ray.max };
+
+			HitRecord closestMeshHit{};
+			const bool hasHit{ IntersectBVH(instance, objectRay, closestMeshHit) };
 
-			IntersectBVH(mesh, ray, hitRecord, hasHit, tempHit, mesh.rootNodeIdx, ignoreHitRecord);
+			if (hasHit)
+			{
+				// back to world space
+				hitRecord = closestMeshHit;
+				hitRecord.origin = ray.origin + (ray.direction * hitRecord.t);
+				hitRecord.normal = instance.normalToWorld.TransformVector(hitRecord.normal).Normalized();
+			}
 
 			return hasHit;
 		}
 
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		// Occlusion test (shadow rays)
+		inline bool HitTest_TriangleMesh(const TriangleMeshInstance& instance, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_TriangleMesh(mesh, ray, temp, true);
+			const Vector3 objectDirection{ instance.worldToObject.TransformVector(ray.direction) };
+			const Ray objectRay{ instance.worldToObject.TransformPoint(ray.origin), objectDirection,
+				{ 1.0f / objectDirection.x, 1.0f / objectDirection.y, 1.0f / objectDirection.z }, ray.min, ray.max };
+
+			return DoesHitBVH(instance, objectRay);
 		}
 
 		
+#pragma endregion
+#pragma region Packet HitTests
+		// Packet versions of the hit tests above, N rays against one primitive at a time.
+		// 'active' masks out the lanes that should not be touched, closer hits update hitRecord.t and the record of that lane.
+
+		template<int N>
+		inline simd::vfloat<N> IntersectAABB_Packet(const RayPacket<N>& ray, const Vector3& minAABB, const Vector3& maxAABB, const simd::vfloat<N>& tClosest, simd::vfloat<N>& entryT)
+		{
+			using vfloat = simd::vfloat<N>;
+
+			const vfloat tx1{ (vfloat{ minAABB.x } - ray.originX) * ray.inverseDirectionX };
+			const vfloat tx2{ (vfloat{ maxAABB.x } - ray.originX) * ray.inverseDirectionX };
+			vfloat tmin{ Min(tx1, tx2) };
+			vfloat tmax{ Max(tx1, tx2) };
+
+			const vfloat ty1{ (vfloat{ minAABB.y } - ray.originY) * ray.inverseDirectionY };
+			const vfloat ty2{ (vfloat{ maxAABB.y } - ray.originY) * ray.inverseDirectionY };
+			tmin = Max(tmin, Min(ty1, ty2));
+			tmax = Min(tmax, Max(ty1, ty2));
+
+			const vfloat tz1{ (vfloat{ minAABB.z } - ray.originZ) * ray.inverseDirectionZ };
+			const vfloat tz2{ (vfloat{ maxAABB.z } - ray.originZ) * ray.inverseDirectionZ };
+			tmin = Max(tmin, Min(tz1, tz2));
+			tmax = Min(tmax, Max(tz1, tz2));
+
+			entryT = tmin;
+
+			// boxes starting behind the closest hit can't hold anything closer
+			return (tmax > vfloat::Zero()) & (tmax >= tmin) & (tmin < tClosest);
+		}
+
+		// node + the lanes that entered it + where they did, so lanes can drop out once they found something closer
+		template<int N>
+		struct PacketStackEntry
+		{
+			unsigned int nodeIdx;
+			simd::vfloat<N> mask;
+			simd::vfloat<N> entryT;
+		};
+
+		// Slabtests both children of a binary node (mesh or top level), the child the first active ray reaches first ends up on top of the stack
+		template<int N, typename Node>
+		inline void PushChildren_Packet(const Node* pNodes, unsigned int leftNode, const RayPacket<N>& ray, const simd::vfloat<N>& active, const simd::vfloat<N>& tClosest,
+			PacketStackEntry<N>* pStack, int& stackSize)
+		{
+			using vfloat = simd::vfloat<N>;
+
+			vfloat leftEntryT{};
+			vfloat rightEntryT{};
+			const vfloat leftMask{ active & IntersectAABB_Packet(ray, pNodes[leftNode].minAABB, pNodes[leftNode].maxAABB, tClosest, leftEntryT) };
+			const vfloat rightMask{ active & IntersectAABB_Packet(ray, pNodes[leftNode + 1].minAABB, pNodes[leftNode + 1].maxAABB, tClosest, rightEntryT) };
+
+			const int leftLanes{ MoveMask(leftMask) };
+			const int rightLanes{ MoveMask(rightMask) };
+
+			if (leftLanes != 0 && rightLanes != 0)
+			{
+				// the packet is coherent, so the first ray is a good stand in for the others
+				const int lane{ simd::LowestLane(MoveMask(active)) };
+				if (leftEntryT[lane] <= rightEntryT[lane])
+				{
+					pStack[stackSize++] = { leftNode + 1, rightMask, rightEntryT };
+					pStack[stackSize++] = { leftNode, leftMask, leftEntryT };
+				}
+				else
+				{
+					pStack[stackSize++] = { leftNode, leftMask, leftEntryT };
+					pStack[stackSize++] = { leftNode + 1, rightMask, rightEntryT };
+				}
+			}
+			else if (leftLanes != 0)
+			{
+				pStack[stackSize++] = { leftNode, leftMask, leftEntryT };
+			}
+			else if (rightLanes != 0)
+			{
+				pStack[stackSize++] = { leftNode + 1, rightMask, rightEntryT };
+			}
+		}
+
+		template<int N>
+		inline void HitTest_Sphere_Packet(const Sphere& sphere, const RayPacket<N>& ray, PacketHitRecord<N>& hitRecord, const simd::vfloat<N>& active)
+		{
+			using vfloat = simd::vfloat<N>;
+
+			const vfloat tcX{ vfloat{ sphere.origin.x } - ray.originX };
+			const vfloat tcY{ vfloat{ sphere.origin.y } - ray.originY };
+			const vfloat tcZ{ vfloat{ sphere.origin.z } - ray.originZ };
+
+			const vfloat dp{ tcX * ray.directionX + tcY * ray.directionY + tcZ * ray.directionZ };
+			const vfloat odSqr{ tcX * tcX + tcY * tcY + tcZ * tcZ - dp * dp };
+			const vfloat radiusSqr{ sphere.radius * sphere.radius };
+
+			vfloat mask{ active & (odSqr <= radiusSqr) };
+			if (MoveMask(mask) == 0)
+				return;
+
+			const vfloat t{ dp - Sqrt(Max(radiusSqr - odSqr, vfloat::Zero())) };
+			mask = mask & (t > ray.min) & (t < hitRecord.t);
+
+			int hitLanes{ MoveMask(mask) };
+			if (hitLanes == 0)
+				return;
+
+			hitRecord.t = Select(mask, t, hitRecord.t);
+			while (hitLanes != 0)
+			{
+				const int lane{ simd::LowestLane(hitLanes) };
+				hitLanes &= hitLanes - 1;
+
+				HitRecord& laneHit{ hitRecord.hits[lane] };
+				laneHit.t = t[lane];
+				laneHit.origin = ray.GetOrigin(lane) + laneHit.t * ray.GetDirection(lane);
+				laneHit.normal = (laneHit.origin - sphere.origin).Normalized();
+				laneHit.materialIndex = sphere.materialIndex;
+				laneHit.objectId = sphere.objectId;
+				laneHit.primitiveIndex = 0;
+				laneHit.didHit = true;
+			}
+		}
+
+		template<int N>
+		inline void HitTest_Plane_Packet(const Plane& plane, const RayPacket<N>& ray, PacketHitRecord<N>& hitRecord, const simd::vfloat<N>& active)
+		{
+			using vfloat = simd::vfloat<N>;
+
+			const vfloat normalX{ plane.normal.x };
+			const vfloat normalY{ plane.normal.y };
+			const vfloat normalZ{ plane.normal.z };
+
+			const vfloat numerator{ (vfloat{ plane.origin.x } - ray.originX) * normalX + (vfloat{ plane.origin.y } - ray.originY) * normalY + (vfloat{ plane.origin.z } - ray.originZ) * normalZ };
+			const vfloat denominator{ ray.directionX * normalX + ray.directionY * normalY + ray.directionZ * normalZ };
+			const vfloat t{ numerator / denominator };
+
+			const vfloat mask{ active & (t > ray.min) & (t < hitRecord.t) };
+			int hitLanes{ MoveMask(mask) };
+			if (hitLanes == 0)
+				return;
+
+			hitRecord.t = Select(mask, t, hitRecord.t);
+			while (hitLanes != 0)
+			{
+				const int lane{ simd::LowestLane(hitLanes) };
+				hitLanes &= hitLanes - 1;
+
+				HitRecord& laneHit{ hitRecord.hits[lane] };
+				laneHit.t = t[lane];
+				laneHit.origin = ray.GetOrigin(lane) + laneHit.t * ray.GetDirection(lane);
+				laneHit.normal = plane.normal;
+				laneHit.materialIndex = plane.materialIndex;
+				laneHit.objectId = plane.objectId;
+				laneHit.primitiveIndex = 0;
+				laneHit.didHit = true;
+			}
+		}
+
+		// Moller-Trumbore for one leaf triangle against all lanes, returns the lanes that found a closer hit (t is written to 'rayT')
+		template<int N>
+		inline simd::vfloat<N> HitTest_Triangle_Packet(const LeafTriangles& triangles, unsigned int triangle, TriangleCullMode cullMode,
+			const RayPacket<N>& ray, const simd::vfloat<N>& tClosest, const simd::vfloat<N>& active, simd::vfloat<N>& rayT)
+		{
+			using vfloat = simd::vfloat<N>;
+			const vfloat zero{ vfloat::Zero() };
+
+			// culling, same rules as the single ray test
+			const vfloat dotNormalDirection{ ray.directionX * vfloat{ triangles.normalX[triangle] } + ray.directionY * vfloat{ triangles.normalY[triangle] } + ray.directionZ * vfloat{ triangles.normalZ[triangle] } };
+			vfloat mask{ active & ((dotNormalDirection < zero) | (dotNormalDirection > zero)) };
+			switch (cullMode)
+			{
+			case TriangleCullMode::FrontFaceCulling:
+				mask = mask & (dotNormalDirection >= zero);
+				break;
+			case TriangleCullMode::BackFaceCulling:
+				mask = mask & (dotNormalDirection <= zero);
+				break;
+			case TriangleCullMode::NoCulling:
+				break;
+			}
+			if (MoveMask(mask) == 0)
+				return mask;
+
+			const vfloat edge1X{ triangles.edge1X[triangle] }, edge1Y{ triangles.edge1Y[triangle] }, edge1Z{ triangles.edge1Z[triangle] };
+			const vfloat edge2X{ triangles.edge2X[triangle] }, edge2Y{ triangles.edge2Y[triangle] }, edge2Z{ triangles.edge2Z[triangle] };
+
+			// cross(direction, edge2)
+			const vfloat pX{ ray.directionY * edge2Z - ray.directionZ * edge2Y };
+			const vfloat pY{ ray.directionZ * edge2X - ray.directionX * edge2Z };
+			const vfloat pZ{ ray.directionX * edge2Y - ray.directionY * edge2X };
+
+			const vfloat det{ edge1X * pX + edge1Y * pY + edge1Z * pZ };
+			const vfloat epsilon{ FLT_EPSILON };
+			mask = mask & ((det <= -epsilon) | (det >= epsilon));
+
+			const vfloat invDet{ vfloat{ 1.f } / det };
+
+			const vfloat sX{ ray.originX - vfloat{ triangles.v0X[triangle] } };
+			const vfloat sY{ ray.originY - vfloat{ triangles.v0Y[triangle] } };
+			const vfloat sZ{ ray.originZ - vfloat{ triangles.v0Z[triangle] } };
+
+			const vfloat baryU{ (sX * pX + sY * pY + sZ * pZ) * invDet };
+			mask = mask & (baryU >= zero) & (baryU <= vfloat{ 1.f });
+
+			// cross(s, edge1)
+			const vfloat qX{ sY * edge1Z - sZ * edge1Y };
+			const vfloat qY{ sZ * edge1X - sX * edge1Z };
+			const vfloat qZ{ sX * edge1Y - sY * edge1X };
+
+			const vfloat baryV{ (ray.directionX * qX + ray.directionY * qY + ray.directionZ * qZ) * invDet };
+			mask = mask & (baryV >= zero) & (baryU + baryV <= vfloat{ 1.f });
+
+			rayT = (edge2X * qX + edge2Y * qY + edge2Z * qZ) * invDet;
+			return mask & (rayT >= ray.min) & (rayT < tClosest);
+		}
+
+		template<int N>
+		inline void IntersectBVH_Packet(const TriangleMeshInstance& instance, const RayPacket<N>& ray, PacketHitRecord<N>& hitRecord, const simd::vfloat<N>& active, simd::vfloat<N>& meshHitMask)
+		{
+			using vfloat = simd::vfloat<N>;
+			const TriangleMesh& mesh = *instance.pMesh;
+
+			PacketStackEntry<N> stack[BVHStackSize];
+			int stackSize{ 0 };
+
+			// the packet enters a node as soon as one of its rays does
+			vfloat rootEntryT{};
+			const vfloat rootMask{ active & IntersectAABB_Packet(ray, mesh.bvhNodeView[mesh.rootNodeIdx].minAABB, mesh.bvhNodeView[mesh.rootNodeIdx].maxAABB, hitRecord.t, rootEntryT) };
+			if (MoveMask(rootMask) == 0)
+				return;
+			stack[stackSize++] = { mesh.rootNodeIdx, rootMask, rootEntryT };
+
+			while (stackSize > 0)
+			{
+				const PacketStackEntry<N> entry{ stack[--stackSize] };
+
+				// lanes that hit something in front of this node since it got pushed are done with it
+				const vfloat nodeMask{ entry.mask & (entry.entryT < hitRecord.t) };
+				if (MoveMask(nodeMask) == 0)
+					continue;
+
+				const BVHNode& node = mesh.bvhNodeView[entry.nodeIdx];
+				if (node.IsLeaf() == false)
+				{
+					PushChildren_Packet(mesh.bvhNodeView.data(), node.leftNode, ray, nodeMask, hitRecord.t, stack, stackSize);
+					continue;
+				}
+
+				for (unsigned int i{ 0 }; i < node.triCount; i += 3)
+				{
+					const unsigned int index{ node.firstTriIdx + i };
+
+					vfloat t{};
+					const vfloat hitMask{ HitTest_Triangle_Packet(mesh.leafTriangles, index / 3, instance.cullMode, ray, hitRecord.t, nodeMask, t) };
+
+					int hitLanes{ MoveMask(hitMask) };
+					if (hitLanes == 0)
+						continue;
+
+					hitRecord.t = Select(hitMask, t, hitRecord.t);
+					meshHitMask = meshHitMask | hitMask;
+					while (hitLanes != 0)
+					{
+						const int lane{ simd::LowestLane(hitLanes) };
+						hitLanes &= hitLanes - 1;
+
+						// origin + normal are moved to world space once the whole mesh is done
+						HitRecord& laneHit{ hitRecord.hits[lane] };
+						laneHit.t = t[lane];
+						laneHit.normal = mesh.normalView[index / 3];
+						laneHit.materialIndex = instance.materialIndex;
+						laneHit.objectId = instance.objectId;
+						laneHit.primitiveIndex = index / 3;
+						laneHit.didHit = true;
+					}
+				}
+			}
+		}
+
+		template<int N>
+		inline void HitTest_TriangleMesh_Packet(const TriangleMeshInstance& instance, const RayPacket<N>& ray, PacketHitRecord<N>& hitRecord, const simd::vfloat<N>& active)
+		{
+			using vfloat = simd::vfloat<N>;
+
+			// Move the packet into object space, same as the single ray version (directions are not normalized)
+			const Vector4 row0{ instance.worldToObject[0] };
+			const Vector4 row1{ instance.worldToObject[1] };
+			const Vector4 row2{ instance.worldToObject[2] };
+			const Vector4 row3{ instance.worldToObject[3] };
+
+			RayPacket<N> objectRay{};
+			objectRay.originX = ray.originX * vfloat{ row0.x } + ray.originY * vfloat{ row1.x } + ray.originZ * vfloat{ row2.x } + vfloat{ row3.x };
+			objectRay.originY = ray.originX * vfloat{ row0.y } + ray.originY * vfloat{ row1.y } + ray.originZ * vfloat{ row2.y } + vfloat{ row3.y };
+			objectRay.originZ = ray.originX * vfloat{ row0.z } + ray.originY * vfloat{ row1.z } + ray.originZ * vfloat{ row2.z } + vfloat{ row3.z };
+			objectRay.directionX = ray.directionX * vfloat{ row0.x } + ray.directionY * vfloat{ row1.x } + ray.directionZ * vfloat{ row2.x };
+			objectRay.directionY = ray.directionX * vfloat{ row0.y } + ray.directionY * vfloat{ row1.y } + ray.directionZ * vfloat{ row2.y };
+			objectRay.directionZ = ray.directionX * vfloat{ row0.z } + ray.directionY * vfloat{ row1.z } + ray.directionZ * vfloat{ row2.z };
+			objectRay.inverseDirectionX = vfloat{ 1.f } / objectRay.directionX;
+			objectRay.inverseDirectionY = vfloat{ 1.f } / objectRay.directionY;
+			objectRay.inverseDirectionZ = vfloat{ 1.f } / objectRay.directionZ;
+			objectRay.min = ray.min;
+
+			vfloat meshHitMask{ vfloat::Zero() };
+			IntersectBVH_Packet(instance, objectRay, hitRecord, active, meshHitMask);
+
+			// back to world space
+			int hitLanes{ MoveMask(meshHitMask) };
+			while (hitLanes != 0)
+			{
+				const int lane{ simd::LowestLane(hitLanes) };
+				hitLanes &= hitLanes - 1;
+
+				HitRecord& laneHit{ hitRecord.hits[lane] };
+				laneHit.origin = ray.GetOrigin(lane) + laneHit.t * ray.GetDirection(lane);
+				laneHit.normal = instance.normalToWorld.TransformVector(laneHit.normal).Normalized();
+			}
+		}
 #pragma endregion
 	}
 
@@ -311,90 +894,30 @@ namespace dae
 	namespace Utils
 	{
 		//Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		inline bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
 		{
-			std::ifstream file(filename);
-			if (!file)
-				return false;
-
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
-			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
-				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
-				}
-				else if (sCommand == "f")
-				{
-					float i0, i1, i2;
-
-#if defined(MAYA_IMPORT)
-					// code used from Sander De Keukelaere
-					// first asked and got permission to do so
-					// this code will only be used to import the extra scene from maya
-					std::string s0, s1, s2;
-					file >> s0 >> s1 >> s2;
-					const char delimiter{ '/' };
-					if (!(s0.size() > 0 && s1.size() > 0 && s2.size() > 0)) continue;
-					i0 = std::stof(s0.substr(0, s0.find(delimiter)));
-					i1 = std::stof(s1.substr(0, s1.find(delimiter)));
-					i2 = std::stof(s2.substr(0, s2.find(delimiter)));
-#else
-					file >> i0 >> i1 >> i2;
-#endif
-
-
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
-				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
-
-				if (file.eof()) 
-					break;
-			}
-
-			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
-			{
-				uint32_t i0 = indices[index];
-				uint32_t i1 = indices[index + 1];
-				uint32_t i2 = indices[index + 2];
+			return ObjParser::Parse(filename, positions, normals, indices);
+		}
 
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
+		// ParseOBJ + BuildBVH, the result gets cached next to the OBJ so the next load can skip both
+		// set the BVH build settings on the mesh before calling this, they're part of the cache key
+		inline bool LoadOBJ(const std::string& filename, TriangleMesh& mesh, bool useCache = true)
+		{
+			const uint64_t sourceHash{ useCache ? MeshCache::HashFile(filename) : 0 };
+			const std::string cacheFilename{ MeshCache::GetCachePath(filename) };
+			if (useCache && MeshCache::Load(cacheFilename, sourceHash, mesh))
+				return true;
 
-				if(isnan(normal.x))
-				{
-					int k = 0;
-				}
+			if (!ParseOBJ(filename, mesh.positions, mesh.normals, mesh.indices))
+				return false;
 
-				normal.Normalize();
-				if (isnan(normal.x))
-				{
-					int k = 0;
-				}
+			mesh.BuildBVH();
 
-				normals.push_back(normal);
-			}
+			// not being able to write the cache only costs time on the next load
+			if (useCache)
+				MeshCache::Save(cacheFilename, sourceHash, mesh);
 
 			return true;
 		}
-#pragma warning(pop)
 	}
 }
\ No newline at end of file
@@ -1,9 +1,16 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+
+#include "MathHelpers.h"
 
 namespace dae
 {
 	struct Vector3;
-	struct Vector4
+
+	// 16 byte aligned so it loads straight into an SSE register
+	struct alignas(16) Vector4
 	{
 		float x;
 		float y;
@@ -11,22 +18,114 @@ namespace dae
 		float w;
 
 		Vector4() = default;
-		Vector4(float _x, float _y, float _z, float _w);
-		Vector4(const Vector3& v, float _w);
+		constexpr Vector4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+		constexpr Vector4(const Vector3& v, float _w);
+
+#if defined(MATH_USE_SSE)
+		__m128 Load() const { return _mm_load_ps(&x); }
+
+		static Vector4 Store(__m128 v)
+		{
+			Vector4 result;
+			_mm_store_ps(&result.x, v);
+			return result;
+		}
+#endif
+
+		float Magnitude() const
+		{
+			return std::sqrt(SqrMagnitude());
+		}
+
+		constexpr float SqrMagnitude() const
+		{
+			return Dot(*this, *this);
+		}
 
-		float Magnitude() const;
-		float SqrMagnitude() const;
-		float Normalize();
-		Vector4 Normalized() const;
+		float Normalize()
+		{
+			const float m = Magnitude();
+			x /= m;
+			y /= m;
+			z /= m;
+			w /= m;
 
-		static float Dot(const Vector4& v1, const Vector4& v2);
+			return m;
+		}
+
+		Vector4 Normalized() const
+		{
+			const float m = Magnitude();
+			return { x / m, y / m, z / m, w / m };
+		}
+
+		static constexpr float Dot(const Vector4& v1, const Vector4& v2)
+		{
+			return ((v1.x * v2.x) + (v1.y * v2.y) + (v1.z * v2.z) + (v1.w * v2.w));
+		}
 
 		// operator overloading
-		Vector4 operator*(float scale) const;
-		Vector4 operator+(const Vector4& v) const;
-		Vector4 operator-(const Vector4& v) const;
-		Vector4& operator+=(const Vector4& v);
-		float& operator[](int index);
-		float operator[](int index) const;
+		constexpr Vector4 operator*(float scale) const
+		{
+#if defined(MATH_USE_SSE)
+			if (!std::is_constant_evaluated())
+				return Store(_mm_mul_ps(Load(), _mm_set1_ps(scale)));
+#endif
+			return { x * scale, y * scale, z * scale, w * scale };
+		}
+
+		constexpr Vector4 operator+(const Vector4& v) const
+		{
+#if defined(MATH_USE_SSE)
+			if (!std::is_constant_evaluated())
+				return Store(_mm_add_ps(Load(), v.Load()));
+#endif
+			return { x + v.x, y + v.y, z + v.z, w + v.w };
+		}
+
+		constexpr Vector4 operator-(const Vector4& v) const
+		{
+#if defined(MATH_USE_SSE)
+			if (!std::is_constant_evaluated())
+				return Store(_mm_sub_ps(Load(), v.Load()));
+#endif
+			return { x - v.x, y - v.y, z - v.z, w - v.w };
+		}
+
+		constexpr Vector4& operator+=(const Vector4& v)
+		{
+			*this = *this + v;
+			return *this;
+		}
+
+		constexpr bool operator==(const Vector4& v) const = default;
+
+		constexpr float& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+
+			if (index == 0)return x;
+			if (index == 1)return y;
+			if (index == 2)return z;
+			return w;
+		}
+
+		constexpr float operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+
+			if (index == 0)return x;
+			if (index == 1)return y;
+			if (index == 2)return z;
+			return w;
+		}
 	};
 }
+
+// the Vector3 constructor needs the full type, Vector3.h includes this header as well
+#include "Vector3.h"
+
+namespace dae
+{
+	constexpr Vector4::Vector4(const Vector3& v, float _w) : x(v.x), y(v.y), z(v.z), w(_w) {}
+}
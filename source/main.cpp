@@ -5,12 +5,16 @@
 #undef main
 
 //Standard includes
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "MeshFile.h"
+#include "Utils.h"
 
 using namespace dae;
 
@@ -20,11 +24,52 @@ void ShutDown(SDL_Window* pWindow)
 	SDL_Quit();
 }
 
+// OBJ -> binary mesh file (see MeshFile), builds the BVH with the default settings
+int ConvertMesh(const char* objFilename, const char* meshFilename)
+{
+	TriangleMesh mesh{};
+	if (!Utils::LoadOBJ(objFilename, mesh, false))
+	{
+		std::cout << "Could not load " << objFilename << std::endl;
+		return 1;
+	}
+
+	if (!MeshFile::Save(meshFilename, mesh))
+	{
+		std::cout << "Could not write " << meshFilename << std::endl;
+		return 1;
+	}
+
+	std::cout << "Converted " << objFilename << " (" << mesh.indices.size() / 3 << " triangles) to " << meshFilename << std::endl;
+	return 0;
+}
+
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	// --convert-mesh <obj> <rtmesh> : offline conversion, no window gets opened
+	if (argc == 4 && strcmp(args[1], "--convert-mesh") == 0)
+		return ConvertMesh(args[2], args[3]);
+
+	//Command line options
+	// --tile-size <pixels> : size of the square tiles handed to the workers
+	// --workers <count>    : amount of render threads, 0 uses all hardware threads
+	// --simd <level>       : sse2, sse4, avx2 or avx512, caps the packet kernels (default: widest the CPU supports)
+	// --target-fps <fps>   : lowers the render resolution while the view moves to hold this frame rate, 0 always renders at the window size
+	uint32_t tileSize{ 32 };
+	uint32_t numWorkers{ 0 };
+	SimdLevel simdLevel{ SimdLevel::AVX512 };
+	float targetFPS{ 30.f };
+	for (int i{ 1 }; i < argc - 1; ++i)
+	{
+		if (strcmp(args[i], "--tile-size") == 0)
+			tileSize = static_cast<uint32_t>(std::atoi(args[++i]));
+		else if (strcmp(args[i], "--workers") == 0)
+			numWorkers = static_cast<uint32_t>(std::atoi(args[++i]));
+		else if (strcmp(args[i], "--simd") == 0 && !CpuFeatures::FromString(args[++i], simdLevel))
+			std::cout << "Unknown simd level " << args[i] << ", using the widest supported one" << std::endl;
+		else if (strcmp(args[i], "--target-fps") == 0)
+			targetFPS = static_cast<float>(std::atof(args[++i]));
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -44,6 +89,14 @@ int main(int argc, char* args[])
 	//Initialize "framework"
 	const auto pTimer = new Timer();
 	const auto pRenderer = new Renderer(pWindow);
+	pRenderer->SetTileSize(tileSize);
+	pRenderer->SetWorkerCount(numWorkers);
+	pRenderer->SetSimdLevel(simdLevel);
+	// F10 switches between this and the full window size, with 0 on the command line it switches to 30 fps
+	const float targetFrameTime{ 1.f / (targetFPS > 0.f ? targetFPS : 30.f) };
+	pRenderer->SetTargetFrameTime(targetFPS > 0.f ? targetFrameTime : 0.f);
+	std::cout << "Rendering " << tileSize << "x" << tileSize << " tiles on " << pRenderer->GetWorkerCount() << " workers"
+		<< " with " << CpuFeatures::ToString(pRenderer->GetSimdLevel()) << " packets" << std::endl;
 
 	//const auto pScene = new Scene_W1();
 	//const auto pScene = new Scene_W2();
@@ -79,15 +132,29 @@ int main(int argc, char* args[])
 					pRenderer->ToggleShadows();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F3)
 					pRenderer->CycleLightingMode();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+					pRenderer->CycleToneMapping();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+					pRenderer->ToggleSRGB();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
 					pTimer->StartBenchmark();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+					pRenderer->ToggleAccumulation();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+					pRenderer->ToggleCheckerboard();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+					pRenderer->ToggleShadingCache();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+					pRenderer->SetTargetFrameTime(pRenderer->GetTargetFrameTime() > 0.f ? 0.f : targetFrameTime);
+				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+					pRenderer->ToggleAdaptiveSampling();
 				break;
 			}
 		}
 
 		//--------- Update ---------
 		pScene->Update(pTimer);
-		pRenderer->Update();
+		pRenderer->Update(pTimer);
 
 		//--------- Render ---------
 		pRenderer->Render(pScene);
@@ -98,7 +165,7 @@ int main(int argc, char* args[])
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			std::cout << "dFPS: " << pTimer->GetdFPS() << " (" << pRenderer->GetRenderWidth() << "x" << pRenderer->GetRenderHeight() << ")" << std::endl;
 		}
 
 		//Save screenshot after full render